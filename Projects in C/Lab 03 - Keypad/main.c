@@ -3,7 +3,10 @@
 
 void System_Clock_Init(void);
 void keypad_pin_init(void); // initialize GPIO pins for keypad
-void delay_ms(unsigned int t); // rudimentary delay millisecond function
+void delay_ms(unsigned int t); // delay millisecond function
+void delay_us(unsigned int t); // delay microsecond function on the DWT cycle counter
+unsigned int msi_frequency(void); // MSI frequency in Hz
+unsigned int system_clock_frequency(void); // current HCLK in Hz
 void clear_row_output(void); // clear PE 10, 11, 12, 13 output bits
 void set_row_output(void); // set PE 10, 11, 12, 13 output bits
 void drive_row_low(char row); // set all row bits except and clear specified row
@@ -168,14 +171,80 @@ void set_row_output(void) {
 GPIOE->ODR |= 0x3C00;
 }
 
-// rudimentary delay millisecond function
+// delay millisecond function
 void delay_ms(unsigned int t) {
-unsigned int i, j;
+unsigned int i;
 for (i = 0; i < t; i++) {
-for (j = 0; j < 2000; j++);
+delay_us(1000);
 }
 }
 
+// delay microsecond function
+// counts core clock cycles with the DWT cycle counter, so the delay does not depend on the
+// compiler optimization level or on the clock selected by System_Clock_Init
+void delay_us(unsigned int t) {
+unsigned int start, cycles;
+CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable the DWT block
+DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; // enable the cycle counter
+start = DWT->CYCCNT;
+cycles = (unsigned int) ((uint64_t) t * system_clock_frequency() / 1000000);
+while ((DWT->CYCCNT - start) < cycles);
+}
+
+// MSI frequency in Hz, from MSIRANGE (or MSISRANGE until MSIRGSEL is set)
+unsigned int msi_frequency(void) {
+const unsigned int msi_range[12] = {100000, 200000, 400000, 800000, 1000000, 2000000,
+4000000, 8000000, 16000000, 24000000, 32000000, 48000000};
+unsigned int range;
+if (RCC->CR & RCC_CR_MSIRGSEL) {
+range = (RCC->CR & RCC_CR_MSIRANGE) >> 4;
+} else {
+range = (RCC->CSR & RCC_CSR_MSISRANGE) >> 8;
+}
+return msi_range[range > 11 ? 11 : range];
+}
+
+// current HCLK (core clock) in Hz: SYSCLK from SWS, the PLL decoded from PLLCFGR, divided
+// by the AHB prescaler (HPRE), as System_Clock_Frequency() in Lab 09
+unsigned int system_clock_frequency(void) {
+unsigned int sysclk, input, pllm, plln, pllr, hpre;
+switch (RCC->CFGR & RCC_CFGR_SWS) {
+case RCC_CFGR_SWS_HSI: // 01: HSI16
+sysclk = 16000000;
+break;
+case RCC_CFGR_SWS_HSE: // 10: HSE (8 MHz MCO of the ST-LINK)
+sysclk = 8000000;
+break;
+case RCC_CFGR_SWS_PLL: // 11: PLL (not used in this lab)
+// PLLSRC: 00 = No clock, 01 = MSI, 10 = HSI, 11 = HSE
+switch (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) {
+case RCC_PLLCFGR_PLLSRC_MSI: input = msi_frequency(); break;
+case RCC_PLLCFGR_PLLSRC_HSI: input = 16000000; break;
+case RCC_PLLCFGR_PLLSRC_HSE: input = 8000000; break;
+default: input = 0; break;
+}
+// f(PLL_R) = f(PLL clock input) * PLLN / PLLM / PLLR
+pllm = ((RCC->PLLCFGR & RCC_PLLCFGR_PLLM) >> 4) + 1; // 000: PLLM = 1, ...
+plln = (RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> 8;
+pllr = (((RCC->PLLCFGR & RCC_PLLCFGR_PLLR) >> 25) + 1) * 2; // 00: PLLR = 2, ...
+sysclk = input / pllm * plln / pllr;
+break;
+default: // 00: MSI
+sysclk = msi_frequency();
+break;
+}
+// AHB prescaler: 0xxx = not divided, 1000 = /2, ..., 1011 = /16, 1100 = /64, ..., 1111 = /512
+hpre = (RCC->CFGR & RCC_CFGR_HPRE) >> 4;
+if (hpre >= 8) {
+hpre -= 7; // 1 - 8
+if (hpre >= 5) {
+hpre++; // /32 is skipped
+}
+sysclk >>= hpre;
+}
+return sysclk;
+}
+
 // initialize GPIO pins for keypad
 void keypad_pin_init(void) {
 // R1->PE10 R2->PE11 R3->PE12 R4->PE13
@@ -1,6 +1,10 @@
 #include "ADC.h"
 #include "LED.h"
+#include "Millivolts.h"
+#include "Ring.h"
+#include "SysClock.h"
 #include "SysTimer.h"
+#include "TIM.h"
 #include "stm32l476xx.h"
 #include <stdint.h>
 
@@ -17,35 +21,59 @@
 // When the delay between two ADC conversions is higher than the above limit, perform two ADC 
 // consecutive conversions in single, scan or continuous mode: the first is a dummy conversion 
 // of any ADC channel. This conversion should not be taken into account by the application.
+// ADC_Read() applies this workaround automatically, see "ADC Errata-Aware Read" below.
 
 // ******************************************************************************************
 // ADC Wakeup
 // By default, the ADC is in deep-power-down mode where its supply is internally switched off
 // to reduce the leakage currents.
 // ******************************************************************************************
-void ADC_Wakeup (void) {
-	
-	int wait_time;
+static void ADC_Wakeup_ADCx (ADC_TypeDef *ADCx) {
 	
 	// To start ADC operations, the following sequence should be applied
 	// DEEPPWD = 0: ADC not in deep-power down
 	// DEEPPWD = 1: ADC in deep-power-down (default reset state)
-	if ((ADC1->CR & ADC_CR_DEEPPWD) == ADC_CR_DEEPPWD)
-		ADC1->CR &= ~ADC_CR_DEEPPWD; // Exit deep power down mode if still in that state
+	if ((ADCx->CR & ADC_CR_DEEPPWD) == ADC_CR_DEEPPWD)
+		ADCx->CR &= ~ADC_CR_DEEPPWD; // Exit deep power down mode if still in that state
 	
 	// Enable the ADC internal voltage regulator
 	// Before performing any operation such as launching a calibration or enabling the ADC, the ADC
 	// voltage regulator must first be enabled and the software must wait for the regulator start-up time.
-	ADC1->CR |= ADC_CR_ADVREGEN;	
+	ADCx->CR |= ADC_CR_ADVREGEN;	
 	
 	// Wait for ADC voltage regulator start-up time
 	// The software must wait for the startup time of the ADC voltage regulator (T_ADCVREG_STUP) 
 	// before launching a calibration or enabling the ADC.
 	// T_ADCVREG_STUP = 20 us
-	wait_time = 20 * (80000000 / 1000000);
-	while(wait_time != 0) {
-		wait_time--;
-	}   
+	delay_us(20);
+}
+
+void ADC_Wakeup (void) {
+	ADC_Wakeup_ADCx(ADC1);
+}
+
+// ******************************************************************************************
+// ADC Enable / Disable
+// ******************************************************************************************
+static void ADC_Enable (ADC_TypeDef *ADCx) {
+	ADCx->ISR |= ADC_ISR_ADRDY;      // ADRDY is cleared by writing 1
+	ADCx->CR  |= ADC_CR_ADEN;  
+	while((ADCx->ISR & ADC_ISR_ADRDY) == 0); 
+	if (ADCx == ADC1)
+		ADC_Errata_Reset();
+}
+
+static void ADC_Disable (ADC_TypeDef *ADCx) {
+	if ((ADCx->CR & ADC_CR_ADEN) == 0)
+		return;
+	
+	// ADDIS can only be set when ADSTART=0 and JADSTART=0
+	if ((ADCx->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART) {
+		ADCx->CR |= ADC_CR_ADSTP;
+		while ((ADCx->CR & ADC_CR_ADSTP) == ADC_CR_ADSTP);
+	}
+	ADCx->CR |= ADC_CR_ADDIS;
+	while ((ADCx->CR & ADC_CR_ADEN) == ADC_CR_ADEN);
 }
 
 // ******************************************************************************************
@@ -63,6 +91,8 @@ void ADC_Common_Configuration(){
 	// V_REFINT enable
 	ADC123_COMMON->CCR |= ADC_CCR_VREFEN;  
 	
+	// Temperature sensor and VBAT/3 stay off (they draw current), see ADC_Sensors_Start()
+	
 	// ADC Clock Source: System Clock, PLLSAI1, PLLSAI2
 	// Maximum ADC Clock: 80 MHz
 	
@@ -79,8 +109,9 @@ void ADC_Common_Configuration(){
 
 	//////////////////////////////////////////////////////////////////////////////////////////////
 	// Independent Mode
-	ADC123_COMMON->CCR &= ~ADC_CCR_DUAL;
-	ADC123_COMMON->CCR |= 6U;  // 00110: Regular simultaneous mode only
+	// ADC_Dual_Init() switches to 00110: Regular simultaneous mode only
+	ADC123_COMMON->CCR &= ~ADC_CCR_DUAL;    // 00000: Independent mode
+	ADC123_COMMON->CCR &= ~(ADC_CCR_MDMA | ADC_CCR_DMACFG);
 }
 
 
@@ -109,11 +140,75 @@ void ADC_Pin_Init(void){
 	GPIOA->ASCR |= GPIO_ASCR_EN_1 | GPIO_ASCR_EN_2;
 }
 
+// ******************************************************************************************
+// ADC Calibration
+// The offsets of the single-ended and the differential inputs are calibrated (ADCAL) while
+// the ADC is disabled. The resulting CALFACT is cached in the RTC backup registers, which
+// survive a reset as long as VBAT is present. On a warm boot ADC_Init() writes CALFACT back
+// instead of recalibrating. Call ADC_Calibrate() to force a new calibration, e.g. after a
+// large change of temperature or VDDA.
+// ******************************************************************************************
+static uint32_t ADC_Calibration_Time;   // CPU cycles spent calibrating or restoring in ADC_Init
+static uint32_t ADC_Calibration_Warm;   // 1 when ADC_Init restored the cached CALFACT
+
+static void ADC_Backup_Write_Enable(void){
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;  // Power interface clock enable
+	(void) RCC->APB1ENR1;                 // Delay after an RCC peripheral clock enabling
+	PWR->CR1 |= PWR_CR1_DBP;              // Enable write access to Backup domain
+	while((PWR->CR1 & PWR_CR1_DBP) == 0);
+}
+
+uint32_t ADC_Calibration_Load(uint32_t *calfact){
+	if (ADC_BKP_KEY_REG != ADC_CALIBRATION_KEY)
+		return 0;   // Cold boot: the backup domain has been reset
+	*calfact = ADC_BKP_CALFACT_REG & (ADC_CALFACT_CALFACT_S | ADC_CALFACT_CALFACT_D);
+	return 1;
+}
+
+// ADCAL can be set only when ADEN=0 (and DEEPPWD=0, ADVREGEN=1, see ADC_Wakeup)
+static void ADC_Calibrate_ADCx(ADC_TypeDef *ADCx){
+	// Single-ended inputs
+	ADCx->CR &= ~ADC_CR_ADCALDIF;
+	ADCx->CR |= ADC_CR_ADCAL;
+	while((ADCx->CR & ADC_CR_ADCAL) == ADC_CR_ADCAL);
+	
+	// Differential inputs
+	ADCx->CR |= ADC_CR_ADCALDIF;
+	ADCx->CR |= ADC_CR_ADCAL;
+	while((ADCx->CR & ADC_CR_ADCAL) == ADC_CR_ADCAL);
+	ADCx->CR &= ~ADC_CR_ADCALDIF;
+}
+
+void ADC_Calibrate(void){
+	uint32_t enabled;
+	
+	enabled = ADC1->CR & ADC_CR_ADEN;
+	ADC_Disable(ADC1);
+	ADC_Calibrate_ADCx(ADC1);
+	
+	// Cache CALFACT_S and CALFACT_D for the next warm boot
+	ADC_Backup_Write_Enable();
+	ADC_BKP_CALFACT_REG = ADC1->CALFACT;
+	ADC_BKP_KEY_REG = ADC_CALIBRATION_KEY;
+	
+	if (enabled)
+		ADC_Enable(ADC1);
+}
+
+uint32_t ADC_Calibration_Cycles(void){
+	return ADC_Calibration_Time;
+}
+
+uint32_t ADC_Calibration_Restored(void){
+	return ADC_Calibration_Warm;
+}
+
 // ******************************************************************************************
 // Initialize ADC	
 // ******************************************************************************************	
 void ADC_Init(void){
 	
+	uint32_t start, restored, calfact;
 	
 	// Enable the clock of ADC
 	RCC->AHB2ENR  |= RCC_AHB2ENR_ADCEN;
@@ -121,14 +216,24 @@ void ADC_Init(void){
 	(void)RCC->AHB2RSTR; // short delay
 	RCC->AHB2RSTR	&= ~RCC_AHB2RSTR_ADCRST;
 	
+	// Cycle counter used to time the calibration and to timestamp conversions (ADC_Read)
+	Cycle_Counter_Init();
+	
 	ADC_Pin_Init();
 	ADC_Common_Configuration();
 	ADC_Wakeup();
 	
+	// Calibration: restore the cached factors on a warm boot, otherwise calibrate (ADEN=0)
+	start = DWT->CYCCNT;
+	restored = ADC_Calibration_Load(&calfact);
+	if (restored == 0)
+		ADC_Calibrate();
+	ADC_Calibration_Time = DWT->CYCCNT - start;
+	ADC_Calibration_Warm = restored;
 	
 	// ADC control register 1 (ADC_CR1)
 	// L1: ADC1->CR1			&= ~(ADC_CR1_RES);							// 
-	ADC1->CFGR &= ~ADC_CFGR_RES;     	// Resolution, (00 = 12-bit, 01 = 10-bit, 10 = 8-bit, 11 = 6-bit)
+	ADC_Resolution_Config(ADC_RES_12); // Resolution, (00 = 12-bit, 01 = 10-bit, 10 = 8-bit, 11 = 6-bit)
 	ADC1->CFGR &= ~ADC_CFGR_ALIGN;   	// Data Alignment (0 = Right alignment, 1 = Left alignment)
 		
 	// L1: ADC1->CR1			&= ~(ADC_CR1_SCAN);							// Scan mode disabled
@@ -142,6 +247,7 @@ void ADC_Init(void){
 	ADC1->SQR1 &= ~ADC_SQR1_SQ1;
 	ADC1->SQR1 |=  ( 6U << 6 );           	// PA1: ADC12_IN6 
 	ADC1->DIFSEL &= ~ADC_DIFSEL_DIFSEL_6; 	// Single-ended for PA1: ADC12_IN6 
+	ADC1->DIFSEL &= ~ADC_DIFSEL_DIFSEL_7; 	// Single-ended for PA2: ADC12_IN7 (DIFSEL is writable only when ADEN=0)
 	
 	// ADC Sample Time
 	// This sampling time must be enough for the input voltage source to charge the embedded
@@ -156,6 +262,8 @@ void ADC_Init(void){
 	// L1: ADC1->SMPR3 		&= ~ADC_SMPR3_SMP5;		// sample time for first channel, NOTE: These bits must be written only when ADON=0. 
 	ADC1->SMPR1  &= ~ADC_SMPR1_SMP6;      // ADC Sample Time
 	ADC1->SMPR1  |= 3U << 18;             // 3: 24.5 ADC clock cycles @80MHz = 0.3 us
+	ADC1->SMPR1  &= ~ADC_SMPR1_SMP0;      // VREFINT (ADC1_IN0) needs at least 4 us
+	ADC1->SMPR1  |= ADC_SMP_640_5;        // 7: 640.5 ADC clock cycles @80MHz = 8 us
 	
 	// ADC control register 2 (ADC_CR2)
 	// L1: ADC1->CR2 			&=  ~ADC_CR2_CONT;    // Disable Continuous conversion mode		
@@ -181,27 +289,1104 @@ void ADC_Init(void){
 	ADC1->CR |= ADC_CR_ADEN;  
 	while((ADC1->ISR & ADC_ISR_ADRDY) == 0); 
 	
+	// CALFACT is writable only when ADEN=1, ADSTART=0 and JADSTART=0
+	if (restored) {
+		start = DWT->CYCCNT;
+		ADC1->CALFACT = calfact;
+		ADC_Calibration_Time += DWT->CYCCNT - start;
+	}
+	ADC_Errata_Reset();
+	
+	ADC_VDDA_Update();   // Millivolt scale for the actual supply
+	
 	// L1: ADC1->CR2  |= ADC_CR2_CFG;       // ADC configuration: 0: Bank A selected; 1: Bank B selected
 	// L1: ADC1->CR2	|= ADC_CR2_SWSTART;		// Start Conversion of regular channels	
 	// L1: while(ADC1->CR2 & ADC_CR2_CFG);	// Wait until configuration completes			
 }
 
 
+// ******************************************************************************************
+// 	ADC Errata-Aware Read
+//  One software-triggered conversion of a one-channel regular sequence (ADSTART must be 0).
+//  Every conversion is timestamped with the DWT cycle counter. When more than 1 ms has passed
+//  since the last conversion (or since the ADC was enabled), a dummy conversion is issued and
+//  discarded first, as required by the errata sheet. Reads closer than 1 ms cost nothing extra.
+//  The gap is converted to cycles at the current HCLK and measured modulo 2^32 cycles
+//  (53 s at 80 MHz).
+// ******************************************************************************************
+static uint32_t ADC_Last_Conversion;   // CYCCNT at the end of the last conversion
+static uint32_t ADC_Last_Valid;        // 0: no conversion since the ADC was enabled
+static uint32_t ADC_Dummy_Conversions; // Extra conversions spent on the workaround
+
+static uint16_t ADC_Convert(void){
+	ADC1->CR |= ADC_CR_ADSTART;
+	while ((ADC1->ISR & ADC_ISR_EOC) == 0);
+	return (uint16_t) ADC1->DR;   // Reading DR clears EOC
+}
+
+void ADC_Errata_Reset(void){
+	ADC_Last_Valid = 0;
+}
+
+uint16_t ADC_Read(void){
+	uint16_t value;
+	uint32_t gap;
+	
+	gap = (uint32_t) ((uint64_t) ADC_ERRATA_GAP_US * System_Clock_Frequency() / 1000000U);
+	if (ADC_Last_Valid == 0 || (DWT->CYCCNT - ADC_Last_Conversion) > gap) {
+		(void) ADC_Convert();         // Dummy conversion, not taken into account
+		ADC_Dummy_Conversions++;
+	}
+	
+	value = ADC_Convert();
+	ADC_Last_Conversion = DWT->CYCCNT;
+	ADC_Last_Valid = 1;
+	return value;
+}
+
+uint32_t ADC_Dummy_Count(void){
+	return ADC_Dummy_Conversions;
+}
+
+// ******************************************************************************************
+// 	ADC Regular Scan Sequence
+//  Converts sequence[0..length-1] (up to 16 ranks) in order on every trigger.
+//  Rank 1..4 -> SQR1, rank 5..9 -> SQR2, rank 10..14 -> SQR3, rank 15..16 -> SQR4
+//  Channel 0..9 -> SMPR1, channel 10..18 -> SMPR2
+//  Software is allowed to write SQRx and SMPRx only when ADSTART=0 and JADSTART=0
+// ******************************************************************************************
+static void ADC_Sequence_Config(ADC_TypeDef *ADCx, const ADC_Channel *sequence, uint32_t length){
+	uint32_t rank, channel, shift;
+	volatile uint32_t *sqr;
+	
+	if (length == 0 || length > 16)
+		return;
+	
+	for (rank = 1; rank <= length; rank++) {
+		channel = sequence[rank - 1].channel & 0x1F;
+		
+		// SQ1 starts at bit 6 of SQR1 (bits 3:0 are L), all other registers start at bit 0
+		if (rank <= 4) {
+			sqr = &ADCx->SQR1;  shift = 6 * rank;
+		} else if (rank <= 9) {
+			sqr = &ADCx->SQR2;  shift = 6 * (rank - 5);
+		} else if (rank <= 14) {
+			sqr = &ADCx->SQR3;  shift = 6 * (rank - 10);
+		} else {
+			sqr = &ADCx->SQR4;  shift = 6 * (rank - 15);
+		}
+		*sqr &= ~(0x1FU << shift);
+		*sqr |=  channel << shift;
+		
+		// Sample time of this channel
+		if (channel < 10) {
+			ADCx->SMPR1 &= ~(7U << (3 * channel));
+			ADCx->SMPR1 |= (sequence[rank - 1].sample_time & 7U) << (3 * channel);
+		} else {
+			ADCx->SMPR2 &= ~(7U << (3 * (channel - 10)));
+			ADCx->SMPR2 |= (sequence[rank - 1].sample_time & 7U) << (3 * (channel - 10));
+		}
+	}
+	
+	// L = number of conversions - 1
+	ADCx->SQR1 &= ~ADC_SQR1_L;
+	ADCx->SQR1 |= (length - 1) & ADC_SQR1_L;
+}
+
+void ADC_Scan_Config(const ADC_Channel *sequence, uint32_t length){
+	ADC_Sequence_Config(ADC1, sequence, length);
+}
+
+// ******************************************************************************************
+// 	Split an interleaved scan buffer into one buffer per channel
+//  samples = [ch0, ch1, ..., ch(count-1), ch0, ch1, ...], length = total number of samples
+//  channels[k] receives length/count samples of rank k+1
+// ******************************************************************************************
+void ADC_Scan_Deinterleave(const uint16_t *samples, uint32_t length, uint16_t * const *channels, uint32_t count){
+	uint32_t i, k, frames;
+	const uint16_t *src;
+	uint16_t *dst;
+	
+	frames = length / count;
+	for (k = 0; k < count; k++) {
+		src = samples + k;
+		dst = channels[k];
+		for (i = 0; i < frames; i++) {
+			dst[i] = *src;
+			src += count;
+		}
+	}
+}
+
+// ******************************************************************************************
+// 	ADC Hardware Oversampling
+//  The oversampler accumulates ratio conversions (2, 4, ..., 256) and shifts the sum right by
+//  shift bits (0..8) before it is written to DR. 12-bit data with ratio = 256 and shift = 4
+//  gives a 16-bit result: 12 + log2(256) - 4 = 16 bits.
+//  mode (can be combined):
+//    ADC_OVS_REGULAR:   oversample the regular group (ROVSE)
+//    ADC_OVS_INJECTED:  oversample the injected group (JOVSE)
+//    ADC_OVS_TRIGGERED: each trigger starts one conversion of the burst (TROVS), otherwise
+//                       one trigger runs all ratio conversions back-to-back
+//    ADC_OVS_RESUMED:   an injected conversion resumes the regular burst instead of
+//                       restarting it (ROVSM)
+//  Software is allowed to write CFGR2 only when ADSTART=0 and JADSTART=0
+// ******************************************************************************************
+void ADC_Oversampling_Config(uint32_t ratio, uint32_t shift, uint32_t mode){
+	uint32_t ovsr;
+	
+	// OVSR: 000 = 2x, 001 = 4x, ..., 111 = 256x
+	ovsr = 0;
+	while ((2U << ovsr) < ratio && ovsr < 7)
+		ovsr++;
+	
+	ADC1->CFGR2 &= ~(ADC_CFGR2_ROVSE | ADC_CFGR2_JOVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM);
+	ADC1->CFGR2 |= (ovsr << 2) & ADC_CFGR2_OVSR;
+	ADC1->CFGR2 |= (shift << 5) & ADC_CFGR2_OVSS;
+	ADC1->CFGR2 |= mode & (ADC_CFGR2_ROVSE | ADC_CFGR2_JOVSE | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM);
+}
+
+void ADC_Oversampling_Disable(void){
+	ADC1->CFGR2 &= ~(ADC_CFGR2_ROVSE | ADC_CFGR2_JOVSE);
+}
+
+// ******************************************************************************************
+// 	ADC Resolution and Sample Time Policy
+//  Conversion time = sampling time (SMP) + successive approximation (12.5, 10.5, 8.5 or 6.5
+//  ADC clock cycles for 12, 10, 8 or 6 bits). With the ADC clock at HCLK = 80 MHz:
+//    12-bit, 2.5 cycles: 80 MHz / 15 = 5.33 Msps      6-bit, 2.5 cycles: 80 MHz / 9 = 8.89 Msps
+//  Times are handled in half ADC clock cycles to stay in integers.
+//  ADC_Policy_Select() trades precision for throughput: it keeps the highest resolution at
+//  which the scan sequence still completes target_rate times per second with the sample
+//  times requested for each channel (the minimum the source impedance allows), then spends
+//  the remaining time on longer sample times, one step at a time for all channels.
+//  Results at 10, 8 or 6 bits stay right aligned (max 1023, 255 or 63). ADC_To_Millivolts()
+//  follows the programmed resolution, and the VREFINT reads are scaled back to 12 bits for
+//  the 12-bit factory calibration (ADC_Injected_12bit).
+//  Software is allowed to write RES and SMPRx only when ADSTART=0 and JADSTART=0.
+// ******************************************************************************************
+static const uint16_t ADC_SMP_Half_Cycles[8] = { 5, 13, 25, 49, 95, 185, 495, 1281 };
+static const uint16_t ADC_SAR_Half_Cycles[4] = { 25, 21, 17, 13 };
+
+void ADC_Resolution_Config(uint32_t resolution){
+	// 00 = 12-bit, 01 = 10-bit, 10 = 8-bit, 11 = 6-bit
+	ADC1->CFGR &= ~ADC_CFGR_RES;
+	ADC1->CFGR |= (resolution & 3U) << 3;
+}
+
+// Programmed resolution in bits: 12, 10, 8 or 6
+static uint32_t ADC_Resolution_Bits(void){
+	return 12 - 2 * ((ADC1->CFGR & ADC_CFGR_RES) >> 3);
+}
+
+// Largest regular result: 2^bits - 1, times 2^(OVSR + 1) shifted right by OVSS with regular
+// oversampling (ROVSE), 16 bits at most
+static uint32_t ADC_Regular_Full_Scale(void){
+	uint32_t full, cfgr2;
+	
+	full = (1U << ADC_Resolution_Bits()) - 1;
+	cfgr2 = ADC1->CFGR2;
+	if (cfgr2 & ADC_CFGR2_ROVSE) {
+		full = (full << (((cfgr2 & ADC_CFGR2_OVSR) >> 2) + 1)) >> ((cfgr2 & ADC_CFGR2_OVSS) >> 5);
+		if (full > 0xFFFFU)
+			full = 0xFFFFU;
+	}
+	return full;
+}
+
+// Injected result in 12-bit LSB, for the formulas based on the 12-bit factory values.
+// Injected oversampling (JOVSE): the sum of 2^(OVSR + 1) conversions shifted right by OVSS,
+// always right aligned, is divided back to one conversion (rounded; data << 14 < 2^30).
+// ALIGN (ADC_Q15_Config) left-aligns the injected data too: bits [15:16 - bits], or [7:2]
+// at 6 bits (byte aligned). The channel must have no offset (OFRx).
+static uint32_t ADC_Injected_12bit(uint32_t data){
+	uint32_t bits, cfgr2, ratio, shift;
+	
+	bits = ADC_Resolution_Bits();
+	cfgr2 = ADC1->CFGR2;
+	if (cfgr2 & ADC_CFGR2_JOVSE) {
+		ratio = ((cfgr2 & ADC_CFGR2_OVSR) >> 2) + 1;     // log2 of the ratio
+		shift = (cfgr2 & ADC_CFGR2_OVSS) >> 5;
+		return ((data << (shift + 12 - bits)) + (1U << (ratio - 1))) >> ratio;
+	}
+	if (ADC1->CFGR & ADC_CFGR_ALIGN)
+		data >>= (bits == 6) ? 2 : 16 - bits;
+	return data << (12 - bits);
+}
+
+// Conversion time of one channel, in half ADC clock cycles
+uint32_t ADC_Conversion_Half_Cycles(uint32_t resolution, uint32_t sample_time){
+	return ADC_SMP_Half_Cycles[sample_time & 7U] + ADC_SAR_Half_Cycles[resolution & 3U];
+}
+
+// ADC clock in Hz. Synchronous clock modes: CKMODE = 01, 10, 11 -> HCLK/1, HCLK/2, HCLK/4.
+// The asynchronous clock (CKMODE = 00) is not used in this lab and returns 0.
+uint32_t ADC_Clock_Frequency(void){
+	uint32_t ckmode;
+	
+	ckmode = (ADC123_COMMON->CCR & ADC_CCR_CKMODE) >> 16;
+	if (ckmode == 0)
+		return 0;
+	return System_Clock_Frequency() >> (ckmode - 1);
+}
+
+// Highest rate (sequences per second) at which the ADC can convert the whole sequence
+uint32_t ADC_Max_Sample_Rate(const ADC_Channel *sequence, uint32_t length, uint32_t resolution){
+	uint32_t i, half_cycles;
+	
+	half_cycles = 0;
+	for (i = 0; i < length; i++)
+		half_cycles += ADC_Conversion_Half_Cycles(resolution, sequence[i].sample_time);
+	if (half_cycles == 0)
+		return 0;
+	return (uint32_t) (((uint64_t) 2 * ADC_Clock_Frequency()) / half_cycles);
+}
+
+// Returns the resolution (ADC_RES_xx) and fills selected[0..length-1],
+// or ADC_RES_NONE when the target cannot be met even at 6 bits
+uint32_t ADC_Policy_Select(const ADC_Channel *sequence, uint32_t length, uint32_t target_rate, ADC_Channel *selected){
+	uint32_t resolution, i, step, raised;   // raised: channels lengthened in this step
+	
+	if (length == 0 || length > 16)
+		return ADC_RES_NONE;
+	
+	for (i = 0; i < length; i++)
+		selected[i] = sequence[i];
+	
+	for (resolution = ADC_RES_12; resolution <= ADC_RES_6; resolution++)
+		if (ADC_Max_Sample_Rate(selected, length, resolution) >= target_rate)
+			break;
+	if (resolution > ADC_RES_6)
+		return ADC_RES_NONE;
+	
+	// Longer sample times while the target is still met
+	for (step = 1; step < 8; step++) {
+		raised = 0;
+		for (i = 0; i < length; i++) {
+			if (selected[i].sample_time < ADC_SMP_640_5) {
+				selected[i].sample_time++;
+				raised |= 1U << i;
+			}
+		}
+		if (raised == 0)
+			break;
+		if (ADC_Max_Sample_Rate(selected, length, resolution) < target_rate) {
+			for (i = 0; i < length; i++)
+				if (raised & (1U << i))
+					selected[i].sample_time--;
+			break;
+		}
+	}
+	return resolution;
+}
+
+// ******************************************************************************************
+// 	ADC Offset and Signed Q15 Output
+//  Up to 4 channels can have an offset subtracted by the ADC itself (OFR1..OFR4):
+//    result = raw - OFFSETy, signed, sign-extended
+//  With left alignment (ALIGN = 1) a 12-bit signed result is written as
+//    DR[15] = sign, DR[14:3] = data, DR[2:0] = 0, i.e. (raw - offset) * 8 in an int16_t.
+//  With the offset at mid-scale (2048) the DMA buffer therefore holds DC-free Q15 samples
+//  (-16384 .. 16376, one LSB = 8) and can be read as int16_t by the DSP code directly.
+//  offset is given in 12-bit LSB (for 10 and 8-bit resolutions OFFSET[1:0] or [3:0] are
+//  ignored). Channels without an offset keep unsigned data, left aligned (raw * 16).
+//  ALIGN also applies to the injected data: the VREFINT, VTS and VBAT reads of ADC_VDDA_Update
+//  and ADC_Sensors_Start are aligned back (ADC_Injected_12bit). Their channels (0, 17, 18)
+//  must not be among the ranks given an offset.
+//  Software is allowed to write OFRx and ALIGN only when ADSTART=0 and JADSTART=0.
+// ******************************************************************************************
+void ADC_Offset_Config(uint32_t index, uint32_t channel, uint32_t offset){
+	uint32_t ofr;
+	
+	ofr = ADC_OFR1_OFFSET1_EN | (channel & 0x1FU) << 26 | (offset & ADC_OFR1_OFFSET1);
+	switch (index) {
+		case 1: ADC1->OFR1 = ofr; break;
+		case 2: ADC1->OFR2 = ofr; break;
+		case 3: ADC1->OFR3 = ofr; break;
+		case 4: ADC1->OFR4 = ofr; break;
+		default: break;
+	}
+}
+
+void ADC_Offset_Disable(uint32_t index){
+	switch (index) {
+		case 1: ADC1->OFR1 &= ~ADC_OFR1_OFFSET1_EN; break;
+		case 2: ADC1->OFR2 &= ~ADC_OFR1_OFFSET1_EN; break;
+		case 3: ADC1->OFR3 &= ~ADC_OFR1_OFFSET1_EN; break;
+		case 4: ADC1->OFR4 &= ~ADC_OFR1_OFFSET1_EN; break;
+		default: break;
+	}
+}
+
+// Signed Q15 stream for the first 4 ranks of sequence, offset subtracted on each of them
+void ADC_Q15_Config(const ADC_Channel *sequence, uint32_t length, uint32_t offset){
+	uint32_t i;
+	
+	for (i = 0; i < 4; i++) {
+		if (i < length)
+			ADC_Offset_Config(i + 1, sequence[i].channel, offset);
+		else
+			ADC_Offset_Disable(i + 1);
+	}
+	ADC1->CFGR |= ADC_CFGR_ALIGN;      // 1 = Left alignment
+}
+
+// Back to unsigned right-aligned data
+void ADC_Q15_Disable(void){
+	uint32_t i;
+	
+	for (i = 1; i <= 4; i++)
+		ADC_Offset_Disable(i);
+	ADC1->CFGR &= ~ADC_CFGR_ALIGN;     // 0 = Right alignment
+}
+
+// Programs the result of ADC_Policy_Select() (ADSTART=0)
+void ADC_Policy_Apply(const ADC_Channel *selected, uint32_t length, uint32_t resolution){
+	if (resolution > ADC_RES_6)
+		return;
+	ADC_Resolution_Config(resolution);
+	ADC_Scan_Config(selected, length);
+}
+
+// ******************************************************************************************
+// 	ADC External Trigger
+//  EXTSEL: ADC_TRIGGER_xxx source of the regular group, see ADC.h
+//  EXTEN:  ADC_TRIGGER_SOFTWARE, ADC_TRIGGER_RISING, ADC_TRIGGER_FALLING, ADC_TRIGGER_BOTH
+//  With a hardware trigger, ADSTART only arms the ADC; every trigger edge starts one
+//  conversion (or one scan sequence) without any CPU involvement.
+// ******************************************************************************************
+void ADC_Trigger_Config(uint32_t source, uint32_t edge){
+	
+	// Software is allowed to write EXTSEL and EXTEN only when ADSTART=0
+	ADC1->CFGR &= ~(ADC_CFGR_EXTSEL | ADC_CFGR_EXTEN);
+	ADC1->CFGR |= (source << 6) & ADC_CFGR_EXTSEL;
+	ADC1->CFGR |= (edge << 10)  & ADC_CFGR_EXTEN;
+}
+
+// ******************************************************************************************
+// 	ADC Timer-Triggered Sampling
+//  TIM4_TRGO triggers ADC1 at sample_rate Hz.
+//  With CKMODE = 01 (HCLK/1, synchronous clock mode) the latency between the trigger edge
+//  and the start of sampling is fixed, so the sampling instants inherit the timer accuracy.
+// ******************************************************************************************
+void ADC_Timer_Trigger_Init(uint32_t sample_rate){
+	ADC_Trigger_Config(ADC_TRIGGER_TIM4_TRGO, ADC_TRIGGER_RISING);
+	TIM4_Init(sample_rate);
+}
+
+void ADC_Set_Sample_Rate(uint32_t sample_rate){
+	TIM4_Set_Frequency(sample_rate);
+}
+
+// ******************************************************************************************
+// 	ADC DMA Circular Acquisition
+//  DMA 1 Channel 1  <--->  ADC1
+//  The ADC runs in continuous mode and the DMA writes every result into a circular buffer.
+//  The half-complete callback gets the first half of the buffer while the DMA fills the
+//  second half, and the complete callback gets the second half while the DMA wraps around.
+//  Software trigger: continuous mode, sample rate = ADC clock / (sample time + 12.5)
+//                    = 80 MHz / (24.5 + 12.5) = 2.16 MHz
+//  Hardware trigger: one conversion (or scan sequence) per trigger edge, see ADC_Timer_Trigger_Init()
+//  In scan mode, length must be a multiple of twice the sequence length so that every half
+//  of the buffer holds whole sequences.
+// ******************************************************************************************
+static void    *ADC_DMA_Buffer;
+static uint32_t ADC_DMA_Length;
+static uint32_t ADC_DMA_Dual;        // 1: 32-bit CDR pairs, 0: 16-bit ADC1 samples
+static ADC_DMA_Callback  ADC_DMA_Half_Callback;
+static ADC_DMA_Callback  ADC_DMA_Full_Callback;
+static ADC_Dual_Callback ADC_Dual_Half_Callback;
+static ADC_Dual_Callback ADC_Dual_Full_Callback;
+static uint32_t ADC_Dual_Read_Index;
+
+// size: DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 (16-bit) or DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1 (32-bit)
+static void ADC_DMA_Channel_Config(volatile uint32_t *peripheral, void *buffer, uint32_t length, uint32_t size){
+	
+	// Enable the clock of DMA 1
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	
+	// DMA channel must be disabled before it can be configured
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	
+	// DMA channel selection register (DMA_CSELR)
+	// 0000: Channel 1 mapped on ADC1
+	DMA1_CSELR->CSELR &= ~DMA_CSELR_C1S;
+	
+	DMA1_Channel1->CPAR  = (uint32_t) peripheral;   // Peripheral address
+	DMA1_Channel1->CMAR  = (uint32_t) buffer;       // Memory address
+	DMA1_Channel1->CNDTR = length;                  // Number of transfers per buffer cycle
+	
+	// DMA channel configuration register (DMA_CCR)
+	//   DIR   = 0: Read from peripheral
+	//   PSIZE = MSIZE = 01: 16-bit transfers, 10: 32-bit transfers
+	//   MINC  = 1: Memory increment, CIRC = 1: Circular mode
+	//   PL    = 10: High priority
+	DMA1_Channel1->CCR &= ~(DMA_CCR_DIR | DMA_CCR_PSIZE | DMA_CCR_MSIZE | DMA_CCR_PL | DMA_CCR_MEM2MEM);
+	DMA1_Channel1->CCR |=   size | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PL_1;
+	DMA1_Channel1->CCR |=   DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE;  // Half transfer, transfer complete, transfer error
+	
+	DMA1->IFCR = DMA_IFCR_CGIF1;  // Clear all pending flags of channel 1
+	NVIC_SetPriority(DMA1_Channel1_IRQn, 0);
+	NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+	
+	DMA1_Channel1->CCR |= DMA_CCR_EN;  // Enable DMA channel
+}
+
+void ADC_DMA_Start(uint16_t *buffer, uint32_t length, ADC_DMA_Callback half, ADC_DMA_Callback full){
+	
+	ADC_DMA_Stop();
+	
+	ADC_DMA_Buffer = buffer;
+	ADC_DMA_Length = length;
+	ADC_DMA_Dual = 0;
+	ADC_DMA_Half_Callback = half;
+	ADC_DMA_Full_Callback = full;
+	
+	ADC_DMA_Channel_Config(&ADC1->DR, buffer, length, DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0);
+	
+	// Software is allowed to write DMAEN, DMACFG and CONT only when ADSTART=0
+	// DMACFG = 1: DMA circular mode, requests keep coming after the last transfer
+	ADC1->CFGR |= ADC_CFGR_DMAEN | ADC_CFGR_DMACFG;
+	if ((ADC1->CFGR & ADC_CFGR_EXTEN) == 0)
+		ADC1->CFGR |= ADC_CFGR_CONT;  // Software trigger: continuous conversion mode
+	
+	ADC1->ISR |= ADC_ISR_OVR;     // Clear any stale overrun
+	ADC1->CR  |= ADC_CR_ADSTART;  // Start conversions (or arm the hardware trigger)
+}
+
+// Restart the 16-bit stream stopped by ADC_DMA_Stop() with the same buffer and callbacks.
+// The DMA starts again at the beginning of the buffer.
+void ADC_DMA_Restart(void){
+	ADC_DMA_Start((uint16_t *) ADC_DMA_Buffer, ADC_DMA_Length, ADC_DMA_Half_Callback, ADC_DMA_Full_Callback);
+}
+
+// Buffer index of the next sample the DMA will write (CNDTR counts down and reloads)
+uint32_t ADC_DMA_Position(void){
+	return (ADC_DMA_Length - DMA1_Channel1->CNDTR) % ADC_DMA_Length;
+}
+
+void ADC_DMA_Stop(void){
+	
+	// Stop an ongoing regular conversion (ADSTP is cleared by hardware once stopped)
+	// In dual mode, ADSTP of the master stops the slave as well
+	if ((ADC1->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART) {
+		ADC1->CR |= ADC_CR_ADSTP;
+		while ((ADC1->CR & ADC_CR_ADSTP) == ADC_CR_ADSTP);
+	}
+	
+	ADC1->CFGR &= ~(ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_CONT | ADC_CFGR_OVRMOD);
+	ADC_Errata_Reset();  // The stream is not timestamped, the next ADC_Read() starts with a dummy
+	ADC2->CFGR &= ~ADC_CFGR_CONT;
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+}
+
+// ******************************************************************************************
+// 	Dual ADC Regular Simultaneous Mode
+//  ADC1 (master) converts master_channel and ADC2 (slave) converts slave_channel at the same
+//  instant, on the trigger of the master. Both results are packed in ADC123_COMMON->CDR:
+//  RDATA_MST in bits 15:0 and RDATA_SLV in bits 31:16. DMA 1 Channel 1 moves one 32-bit word
+//  per pair (MDMA = 10), so the throughput is twice that of ADC1 alone.
+//  Both channels use the same sample time so that the two conversions end together.
+// ******************************************************************************************
+void ADC_Dual_Init(uint32_t master_channel, uint32_t slave_channel, uint32_t sample_time){
+	ADC_Channel channel;
+	
+	ADC_DMA_Stop();
+	
+	// DUAL, MDMA and DMACFG are writable only when both ADCs are disabled
+	ADC_Disable(ADC1);
+	ADC_Disable(ADC2);
+	
+	// ADC2 shares the clock, the pins and the common configuration with ADC1,
+	// but has its own offset: calibrate it while ADEN=0. Its CALFACT is not cached.
+	ADC_Wakeup_ADCx(ADC2);
+	ADC_Calibrate_ADCx(ADC2);
+	ADC2->DIFSEL &= ~(1U << slave_channel);   // Single-ended
+	ADC2->CFGR &= ~(ADC_CFGR_RES | ADC_CFGR_ALIGN);
+	ADC2->CFGR |= ADC1->CFGR & (ADC_CFGR_RES | ADC_CFGR_ALIGN);
+	ADC2->CFGR &= ~(ADC_CFGR_DMAEN | ADC_CFGR_DMACFG);   // Slave data is read through CDR
+	
+	channel.channel = master_channel;
+	channel.sample_time = sample_time;
+	ADC_Sequence_Config(ADC1, &channel, 1);
+	channel.channel = slave_channel;
+	ADC_Sequence_Config(ADC2, &channel, 1);
+	
+	// ADC common control register (ADC_CCR)
+	//   DUAL   = 00110: Regular simultaneous mode only
+	//   MDMA   = 10: One DMA request per pair, for 12-bit and 10-bit resolution
+	//   DMACFG = 1: DMA circular mode
+	ADC123_COMMON->CCR &= ~(ADC_CCR_DUAL | ADC_CCR_MDMA | ADC_CCR_DMACFG);
+	ADC123_COMMON->CCR |= 6U | ADC_CCR_MDMA_1 | ADC_CCR_DMACFG;
+	
+	ADC_Enable(ADC1);
+	ADC_Enable(ADC2);
+}
+
+// ******************************************************************************************
+// 	Dual ADC DMA Ring
+//  The DMA writes pairs into buffer[0..length-1] circularly. The consumer drains new pairs
+//  with ADC_Dual_Read() at least once per length/sample rate, or uses the half/full callbacks.
+// ******************************************************************************************
+void ADC_Dual_DMA_Start(uint32_t *buffer, uint32_t length, ADC_Dual_Callback half, ADC_Dual_Callback full){
+	
+	ADC_DMA_Stop();
+	
+	ADC_DMA_Buffer = buffer;
+	ADC_DMA_Length = length;
+	ADC_DMA_Dual = 1;
+	ADC_Dual_Half_Callback = half;
+	ADC_Dual_Full_Callback = full;
+	ADC_Dual_Read_Index = 0;
+	
+	ADC_DMA_Channel_Config(&ADC123_COMMON->CDR, buffer, length, DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1);
+	
+	// In dual mode the master CONT and trigger settings apply to both ADCs
+	if ((ADC1->CFGR & ADC_CFGR_EXTEN) == 0) {
+		ADC1->CFGR |= ADC_CFGR_CONT;
+		ADC2->CFGR |= ADC_CFGR_CONT;
+	}
+	
+	ADC1->ISR |= ADC_ISR_OVR;
+	ADC2->ISR |= ADC_ISR_OVR;
+	ADC1->CR  |= ADC_CR_ADSTART;  // Starting the master starts the slave
+}
+
+uint32_t ADC_Dual_Read(uint32_t *pairs, uint32_t max){
+	uint32_t write, count;
+	uint32_t *ring = (uint32_t *) ADC_DMA_Buffer;
+	
+	// Index of the next word the DMA will write
+	write = ADC_DMA_Length - DMA1_Channel1->CNDTR;
+	if (write >= ADC_DMA_Length)
+		write = 0;
+	
+	count = 0;
+	while (ADC_Dual_Read_Index != write && count < max) {
+		pairs[count++] = ring[ADC_Dual_Read_Index];
+		if (++ADC_Dual_Read_Index == ADC_DMA_Length)
+			ADC_Dual_Read_Index = 0;
+	}
+	return count;
+}
+
+// ******************************************************************************************
+// 	DMA 1 Channel 1 Interrupt Handler
+// ******************************************************************************************
+void DMA1_Channel1_IRQHandler(void){
+	uint32_t half = ADC_DMA_Length / 2;
+	
+	// Half Transfer: the first half of the buffer is stable
+	if ((DMA1->ISR & DMA_ISR_HTIF1) == DMA_ISR_HTIF1) {
+		DMA1->IFCR = DMA_IFCR_CHTIF1;
+		if (ADC_DMA_Dual) {
+			if (ADC_Dual_Half_Callback != 0)
+				ADC_Dual_Half_Callback((uint32_t *) ADC_DMA_Buffer, half);
+		} else if (ADC_DMA_Half_Callback != 0) {
+			ADC_DMA_Half_Callback((uint16_t *) ADC_DMA_Buffer, half);
+		}
+	}
+	
+	// Transfer Complete: the second half of the buffer is stable
+	if ((DMA1->ISR & DMA_ISR_TCIF1) == DMA_ISR_TCIF1) {
+		DMA1->IFCR = DMA_IFCR_CTCIF1;
+		if (ADC_DMA_Dual) {
+			if (ADC_Dual_Full_Callback != 0)
+				ADC_Dual_Full_Callback((uint32_t *) ADC_DMA_Buffer + half, ADC_DMA_Length - half);
+		} else if (ADC_DMA_Full_Callback != 0) {
+			ADC_DMA_Full_Callback((uint16_t *) ADC_DMA_Buffer + half, ADC_DMA_Length - half);
+		}
+	}
+	
+	// Transfer Error: the channel is disabled by hardware
+	if ((DMA1->ISR & DMA_ISR_TEIF1) == DMA_ISR_TEIF1) {
+		DMA1->IFCR = DMA_IFCR_CGIF1;
+	}
+}
+
+
+// ******************************************************************************************
+// 	ADC Interrupt-Driven Acquisition
+//  Every end of conversion interrupt pushes ADC1->DR into a single-producer/single-consumer
+//  ring (producer = ADC1_2_IRQHandler, consumer = main loop), see Ring.c.
+//  Suited for moderate sample rates (one interrupt per sample); use the DMA path above that.
+// ******************************************************************************************
+static uint16_t ADC_Ring_Buffer[ADC_RING_SIZE];
+static Ring ADC_Ring = { ADC_Ring_Buffer, ADC_RING_SIZE, 0, 0, 0 };
+static volatile uint32_t ADC_Overrun_Count;   // Samples lost by the ADC itself (OVR flag)
+
+void ADC_Ring_Push(uint16_t sample){
+	Ring_Push(&ADC_Ring, sample);
+}
+
+uint32_t ADC_Ring_Read(uint16_t *samples, uint32_t max){
+	return Ring_Read(&ADC_Ring, samples, max);
+}
+
+uint32_t ADC_Ring_Count(void){
+	return Ring_Count(&ADC_Ring);
+}
+
+uint32_t ADC_Ring_Dropped_Count(void){
+	return ADC_Ring.dropped;
+}
+
+uint32_t ADC_Ring_Overrun_Count(void){
+	return ADC_Overrun_Count;
+}
+
+void ADC_IRQ_Start(void){
+	
+	ADC_DMA_Stop();
+	
+	Ring_Init(&ADC_Ring, ADC_Ring_Buffer, ADC_RING_SIZE);
+	ADC_Overrun_Count = 0;
+	
+	if ((ADC1->CFGR & ADC_CFGR_EXTEN) == 0)
+		ADC1->CFGR |= ADC_CFGR_CONT;  // Software trigger: continuous conversion mode
+	
+	ADC1->ISR = ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR;
+	ADC1->IER |= ADC_IER_EOCIE | ADC_IER_OVRIE;   // End of conversion and overrun interrupts
+	NVIC_SetPriority(ADC1_2_IRQn, 0);
+	NVIC_EnableIRQ(ADC1_2_IRQn);
+	
+	ADC1->CR |= ADC_CR_ADSTART;
+}
+
+void ADC_IRQ_Stop(void){
+	ADC_DMA_Stop();
+	ADC1->IER &= ~(ADC_IER_EOCIE | ADC_IER_OVRIE);
+}
+
+// ******************************************************************************************
+// 	ADC Analog Watchdogs
+//  watchdog 1: one channel (AWD1CH), 12-bit thresholds in TR1
+//  watchdog 2/3: any set of channels (AWDxCR), thresholds compared with the 8 MSBs of the
+//                result, so low and high are rounded to multiples of 16
+//  The callback runs in ADC1_2_IRQHandler when a monitored conversion is outside
+//  [low, high]. The interrupt is then disarmed so that a signal that stays outside the
+//  window does not interrupt every conversion; ADC_AWD_Arm() waits for the next crossing.
+//  ADC_AWD_Save() / ADC_AWD_Restore() let a module borrow a watchdog (Scope_Trigger_AWD)
+//  and hand the previous owner its channel, thresholds and callback back.
+//  Software is allowed to write these settings only when ADSTART=0 and JADSTART=0
+// ******************************************************************************************
+static ADC_AWD_Callback ADC_AWD_Callbacks[3];
+
+static uint32_t ADC_AWD_Flag(uint32_t watchdog){
+	if (watchdog == 1) return ADC_ISR_AWD1;
+	if (watchdog == 2) return ADC_ISR_AWD2;
+	return ADC_ISR_AWD3;
+}
+
+void ADC_AWD_Config(uint32_t watchdog, uint32_t channel, uint32_t low, uint32_t high, ADC_AWD_Callback callback){
+	
+	if (watchdog < 1 || watchdog > 3)
+		return;
+	
+	ADC_AWD_Callbacks[watchdog - 1] = callback;
+	
+	if (watchdog == 1) {
+		// AWD1SGL = 1: single channel, AWD1EN = 1: regular group
+		ADC1->CFGR &= ~(ADC_CFGR_AWD1CH | ADC_CFGR_AWD1SGL | ADC_CFGR_AWD1EN);
+		ADC1->CFGR |= ((channel & 0x1F) << 26) | ADC_CFGR_AWD1SGL | ADC_CFGR_AWD1EN;
+		ADC1->TR1 = ((high & 0xFFF) << 16) | (low & 0xFFF);
+	} else if (watchdog == 2) {
+		ADC1->AWD2CR = (1U << channel) & ADC_AWD2CR_AWD2CH;
+		ADC1->TR2 = (((high >> 4) & 0xFF) << 16) | ((low >> 4) & 0xFF);
+	} else {
+		ADC1->AWD3CR = (1U << channel) & ADC_AWD3CR_AWD3CH;
+		ADC1->TR3 = (((high >> 4) & 0xFF) << 16) | ((low >> 4) & 0xFF);
+	}
+	
+	NVIC_SetPriority(ADC1_2_IRQn, 0);
+	NVIC_EnableIRQ(ADC1_2_IRQn);
+	ADC_AWD_Arm(watchdog);
+}
+
+void ADC_AWD_Arm(uint32_t watchdog){
+	ADC1->ISR  = ADC_AWD_Flag(watchdog);   // Forget crossings seen while disarmed
+	ADC1->IER |= ADC_AWD_Flag(watchdog);   // AWDxIE has the same position as AWDx
+}
+
+// The watchdog keeps comparing, only its interrupt is off until ADC_AWD_Arm()
+void ADC_AWD_Disarm(uint32_t watchdog){
+	ADC1->IER &= ~ADC_AWD_Flag(watchdog);
+}
+
+void ADC_AWD_Disable(uint32_t watchdog){
+	ADC1->IER &= ~ADC_AWD_Flag(watchdog);
+	if (watchdog == 1)
+		ADC1->CFGR &= ~ADC_CFGR_AWD1EN;
+	else if (watchdog == 2)
+		ADC1->AWD2CR = 0;
+	else
+		ADC1->AWD3CR = 0;
+}
+
+void ADC_AWD_Save(uint32_t watchdog, ADC_AWD_Settings *settings){
+	
+	if (watchdog < 1 || watchdog > 3)
+		return;
+	
+	settings->callback = ADC_AWD_Callbacks[watchdog - 1];
+	settings->armed = ADC1->IER & ADC_AWD_Flag(watchdog);
+	if (watchdog == 1) {
+		settings->config = ADC1->CFGR & (ADC_CFGR_AWD1CH | ADC_CFGR_AWD1SGL | ADC_CFGR_AWD1EN | ADC_CFGR_JAWD1EN);
+		settings->thresholds = ADC1->TR1;
+	} else if (watchdog == 2) {
+		settings->config = ADC1->AWD2CR;
+		settings->thresholds = ADC1->TR2;
+	} else {
+		settings->config = ADC1->AWD3CR;
+		settings->thresholds = ADC1->TR3;
+	}
+}
+
+void ADC_AWD_Restore(uint32_t watchdog, const ADC_AWD_Settings *settings){
+	
+	if (watchdog < 1 || watchdog > 3)
+		return;
+	
+	ADC1->IER &= ~ADC_AWD_Flag(watchdog);
+	ADC_AWD_Callbacks[watchdog - 1] = settings->callback;
+	if (watchdog == 1) {
+		ADC1->CFGR &= ~(ADC_CFGR_AWD1CH | ADC_CFGR_AWD1SGL | ADC_CFGR_AWD1EN | ADC_CFGR_JAWD1EN);
+		ADC1->CFGR |= settings->config;
+		ADC1->TR1 = settings->thresholds;
+	} else if (watchdog == 2) {
+		ADC1->AWD2CR = settings->config;
+		ADC1->TR2 = settings->thresholds;
+	} else {
+		ADC1->AWD3CR = settings->config;
+		ADC1->TR3 = settings->thresholds;
+	}
+	if (settings->armed != 0)
+		ADC_AWD_Arm(watchdog);
+}
+
+// ******************************************************************************************
+// 	ADC Monitor Mode
+//  Continuous (or triggered) conversions with neither DMA nor end of conversion interrupt:
+//  OVRMOD = 1 lets every result overwrite DR, and only the analog watchdogs wake the CPU.
+//  The core can stay in Sleep (__WFI) until a threshold is crossed.
+// ******************************************************************************************
+void ADC_Monitor_Start(void){
+	
+	ADC_IRQ_Stop();
+	
+	ADC1->CFGR |= ADC_CFGR_OVRMOD;     // Overrun: DR is overwritten with the last conversion
+	if ((ADC1->CFGR & ADC_CFGR_EXTEN) == 0)
+		ADC1->CFGR |= ADC_CFGR_CONT;
+	
+	ADC1->CR |= ADC_CR_ADSTART;
+}
+
+// ******************************************************************************************
+// 	ADC Injected Group
+//  Up to 4 injected conversions (JSQR) with their own trigger (JEXTSEL/JEXTEN) and their own
+//  data registers JDR1..JDR4. An injected trigger preempts the regular group: the regular
+//  conversion in progress is aborted, the injected sequence is converted, and the regular
+//  sequence restarts from the aborted rank on its next trigger. The DMA stream of the
+//  regular group is not stopped. With the timer-triggered scan, the delay from the injected
+//  trigger to the JEOS interrupt is the injected conversion time plus the interrupt entry.
+//    ADC_Injected_Config():  sequence, sample times and trigger. Call it while ADSTART=0 and
+//                            JADSTART=0 (e.g. before ADC_DMA_Start), SMPRx is not writable
+//                            otherwise.
+//    ADC_Injected_Auto():    JAUTO, the injected sequence is converted automatically after
+//                            every regular sequence (the trigger must be software).
+//    ADC_Injected_Start():   JEOS interrupt + callback, JADSTART arms the hardware trigger
+//                            (or converts once with the software trigger).
+//  JQDIS = 1 (reset value): no JSQR queue, JSQR is only written while JADSTART=0.
+// ******************************************************************************************
+static ADC_Injected_Callback ADC_Injected_Done;
+static uint16_t ADC_Injected_Results[4];
+
+void ADC_Injected_Config(const ADC_Channel *sequence, uint32_t length, uint32_t source, uint32_t edge){
+	uint32_t rank, channel, jsqr;
+	
+	if (length == 0 || length > 4)
+		return;
+	
+	ADC_Injected_Stop();
+	
+	// JL = length - 1, JEXTSEL[5:2], JEXTEN[7:6], JSQ1 at bit 8, JSQ2 at bit 14, ...
+	jsqr = (length - 1) | (source & 0xFU) << 2 | (edge & 3U) << 6;
+	for (rank = 1; rank <= length; rank++) {
+		channel = sequence[rank - 1].channel & 0x1F;
+		jsqr |= channel << (2 + 6 * rank);
+		
+		if (channel < 10) {
+			ADC1->SMPR1 &= ~(7U << (3 * channel));
+			ADC1->SMPR1 |= (sequence[rank - 1].sample_time & 7U) << (3 * channel);
+		} else {
+			ADC1->SMPR2 &= ~(7U << (3 * (channel - 10)));
+			ADC1->SMPR2 |= (sequence[rank - 1].sample_time & 7U) << (3 * (channel - 10));
+		}
+	}
+	ADC1->JSQR = jsqr;
+}
+
+// JAUTO is writable only when ADSTART=0 and JADSTART=0
+void ADC_Injected_Auto(uint32_t enable){
+	if (enable) {
+		ADC1->JSQR &= ~ADC_JSQR_JEXTEN;   // Auto-injection works with the software trigger only
+		ADC1->CFGR |= ADC_CFGR_JAUTO;
+	} else {
+		ADC1->CFGR &= ~ADC_CFGR_JAUTO;
+	}
+}
+
+void ADC_Injected_Start(ADC_Injected_Callback callback){
+	ADC_Injected_Done = callback;
+	
+	ADC1->ISR = ADC_ISR_JEOC | ADC_ISR_JEOS;
+	ADC1->IER |= ADC_IER_JEOSIE;
+	NVIC_SetPriority(ADC1_2_IRQn, 0);
+	NVIC_EnableIRQ(ADC1_2_IRQn);
+	
+	// In auto-injection mode the regular group starts the injected sequence (ADSTART)
+	if ((ADC1->CFGR & ADC_CFGR_JAUTO) == 0)
+		ADC1->CR |= ADC_CR_JADSTART;
+}
+
+void ADC_Injected_Stop(void){
+	if (ADC1->CR & ADC_CR_JADSTART) {
+		ADC1->CR |= ADC_CR_JADSTP;
+		while (ADC1->CR & ADC_CR_JADSTP);
+	}
+	ADC1->IER &= ~ADC_IER_JEOSIE;
+	ADC1->ISR = ADC_ISR_JEOC | ADC_ISR_JEOS;
+}
+
+// ******************************************************************************************
+// One software-triggered injected sequence, polled (jsqr with JEXTEN = 00).
+// The configured injected sequence is suspended and restored afterwards, with its trigger
+// re-armed. Only the JSQR is changed: the sample times of the channels must already be set.
+// Returns 0 (nothing converted) in auto-injection mode.
+// ******************************************************************************************
+static uint32_t ADC_Injected_Convert(uint32_t jsqr, uint16_t *results){
+	uint32_t saved_jsqr, armed, interrupt, n;
+	
+	if (ADC1->CFGR & ADC_CFGR_JAUTO)
+		return 0;
+	
+	saved_jsqr = ADC1->JSQR;
+	armed = ADC1->CR & ADC_CR_JADSTART;
+	interrupt = ADC1->IER & ADC_IER_JEOSIE;
+	ADC_Injected_Stop();                  // Also masks JEOS so that the ISR does not take it
+	
+	ADC1->JSQR = jsqr;
+	ADC1->CR |= ADC_CR_JADSTART;
+	while ((ADC1->ISR & ADC_ISR_JEOS) == 0);
+	n = (jsqr & ADC_JSQR_JL) + 1;
+	results[0] = (uint16_t) ADC1->JDR1;
+	if (n > 1) results[1] = (uint16_t) ADC1->JDR2;
+	if (n > 2) results[2] = (uint16_t) ADC1->JDR3;
+	if (n > 3) results[3] = (uint16_t) ADC1->JDR4;
+	ADC1->ISR = ADC_ISR_JEOC | ADC_ISR_JEOS;
+	
+	ADC1->JSQR = saved_jsqr;
+	ADC1->IER |= interrupt;
+	if (armed)
+		ADC1->CR |= ADC_CR_JADSTART;
+	return n;
+}
+
 // ******************************************************************************************
 // 	ADC 1/2 Interrupt Handler
+//  ISR flags are cleared by writing 1; they are written directly (not |=) so that a flag
+//  raised in between is not cleared before it is handled.
 // ******************************************************************************************
 void ADC1_2_IRQHandler(void){
+	uint32_t watchdog, flag, n;
+	
 	NVIC_ClearPendingIRQ(ADC1_2_IRQn);
 	
 	// ADC End of Conversion (EOC)
-	if ((ADC1->ISR & ADC_ISR_EOC) == ADC_ISR_EOC) {
-		// It is cleared by software writing 1 to it or by reading the corresponding ADCx_JDRy register
-		ADC1->ISR |= ADC_ISR_EOC;
+	if ((ADC1->IER & ADC_IER_EOCIE) && (ADC1->ISR & ADC_ISR_EOC) == ADC_ISR_EOC) {
+		// It is cleared by software writing 1 to it or by reading the corresponding ADCx_DR register
+		Ring_Push(&ADC_Ring, (uint16_t) ADC1->DR);
+	}
+	
+	// ADC Overrun (OVR): a conversion finished before DR was read
+	if ((ADC1->ISR & ADC_ISR_OVR) == ADC_ISR_OVR) {
+		ADC_Overrun_Count++;
+		ADC1->ISR = ADC_ISR_OVR;
 	}
 	
-	// ADC End of Injected Sequence of Conversions  (JEOS)
+	// ADC End of Regular Sequence of Conversions (EOS)
 	if ((ADC1->ISR & ADC_ISR_EOS) == ADC_ISR_EOS) {
 		// It is cleared by software writing 1 to it.
-		ADC1->ISR |= ADC_ISR_EOS;		
+		ADC1->ISR = ADC_ISR_EOS;		
+	}
+	
+	// ADC End of Injected Sequence (JEOS): results in JDR1..JDRn
+	if ((ADC1->IER & ADC_IER_JEOSIE) && (ADC1->ISR & ADC_ISR_JEOS) == ADC_ISR_JEOS) {
+		n = (ADC1->JSQR & ADC_JSQR_JL) + 1;
+		ADC_Injected_Results[0] = (uint16_t) ADC1->JDR1;
+		ADC_Injected_Results[1] = (uint16_t) ADC1->JDR2;
+		ADC_Injected_Results[2] = (uint16_t) ADC1->JDR3;
+		ADC_Injected_Results[3] = (uint16_t) ADC1->JDR4;
+		ADC1->ISR = ADC_ISR_JEOC | ADC_ISR_JEOS;
+		if (ADC_Injected_Done != 0)
+			ADC_Injected_Done(ADC_Injected_Results, n);
 	}
-}
\ No newline at end of file
+	
+	// Analog watchdogs 1..3: one-shot, disarmed until ADC_AWD_Arm()
+	for (watchdog = 1; watchdog <= 3; watchdog++) {
+		flag = ADC_AWD_Flag(watchdog);
+		if ((ADC1->IER & flag) && (ADC1->ISR & flag) == flag) {
+			ADC1->IER &= ~flag;
+			ADC1->ISR  = flag;
+			if (ADC_AWD_Callbacks[watchdog - 1] != 0)
+				ADC_AWD_Callbacks[watchdog - 1](watchdog);
+		}
+	}
+}
+// ******************************************************************************************
+// VDDA Measurement
+//  VREFINT (ADC1_IN0) is converted as a one-off injected sequence (ADC_Injected_Convert), so
+//  it can be taken while the regular group keeps converting on the timer trigger and while
+//  an injected sequence is configured. VREFEN is set in ADC_Common_Configuration, the sample
+//  time of channel 0 in ADC_Init. Not available in auto-injection mode (the last value is kept).
+//    VDDA = VREFINT_CAL_VREF * VREFINT_CAL / VREFINT_DATA
+//  The sequence converts VREFINT twice and only the second result is used: the first one is
+//  the dummy conversion required by the errata when the ADC has been idle for more than 1 ms.
+//  The VREFINT sampling time must be at least 4 us: 640.5 ADC clock cycles = 8 us at 80 MHz.
+//  The ADC must be enabled. Blocks for about 17 us.
+// ******************************************************************************************
+static uint32_t ADC_VDDA_mV    = VREFINT_CAL_VREF;    // Last VDDA measurement in mV
+
+// data: VREFINT in 12-bit LSB (ADC_Injected_12bit)
+static void ADC_VDDA_From_VREFINT(uint32_t data){
+	if (data == 0)
+		return;                             // Keep the last measurement
+	
+	ADC_VDDA_mV = Millivolts_VDDA(*VREFINT_CAL_ADDR, data);
+}
+
+uint32_t ADC_VDDA_Update(void){
+	uint32_t data;
+	uint16_t results[4];
+	
+	// JL = 1 (2 conversions), JSQ1 = JSQ2 = channel 0, JEXTEN = 00 (software trigger)
+	if (ADC_Injected_Convert(1U, results) == 0)
+		return ADC_VDDA_mV;
+	data = ADC_Injected_12bit(results[1]);   // results[0] is the dummy conversion
+	
+	ADC_VDDA_From_VREFINT(data);
+	return ADC_VDDA_mV;
+}
+
+uint32_t ADC_VDDA(void){
+	return ADC_VDDA_mV;
+}
+
+// ******************************************************************************************
+// Temperature Sensor and VBAT
+//  Background injected sequence triggered by TIM6_TRGO at a low rate (e.g. 10 Hz), so the
+//  regular stream and its DMA are only paused for the injected conversions (about 33 us).
+//    Rank 1: VBAT/3  (ADC1_IN18)  discarded, precharges the sampling capacitor
+//    Rank 2: VBAT/3  (ADC1_IN18)  VBAT needs 12 us of sampling, 640.5 cycles are 8 us at
+//                                 80 MHz: the second conversion starts from the first one
+//    Rank 3: VTS     (ADC1_IN17)  at least 5 us of sampling
+//    Rank 4: VREFINT (ADC1_IN0)   keeps VDDA (ADC_VDDA) up to date at the same time
+//  The first conversion also serves as the errata dummy when the ADC has been idle.
+//  Temperature, from the two factory points taken at VDDA = 3.0 V:
+//    TS_3V = TS_DATA * VDDA / 3000
+//    T = (TS_CAL2_TEMP - TS_CAL1_TEMP) * (TS_3V - TS_CAL1) / (TS_CAL2 - TS_CAL1) + TS_CAL1_TEMP
+//  VBAT = 3 * VBAT_DATA * VDDA / 4095
+//  The DATA are the 12-bit right-aligned equivalents of the results (ADC_Injected_12bit), so
+//  the formulas hold at any resolution, with ALIGN set and with injected oversampling.
+//  This uses the injected group: ADC_Sensors_Start() replaces any ADC_Injected_Config().
+//  TSEN and VBATEN are only set between ADC_Sensors_Start() and ADC_Sensors_Stop(): the
+//  VBAT bridge draws a few uA from VBAT and the sensor some more from VDDA while enabled.
+//  The temperature sensor needs 120 us to start up, done long before the first trigger.
+//  Call both while ADSTART=0 (before ADC_DMA_Start / after ADC_DMA_Stop): sample times are
+//  written here and CCR is writable only while the ADCs are disabled.
+// ******************************************************************************************
+static const ADC_Channel ADC_Sensors_Sequence[4] = {
+	{ 18, ADC_SMP_640_5 },     // VBAT/3, discarded
+	{ 18, ADC_SMP_640_5 },     // VBAT/3
+	{ 17, ADC_SMP_640_5 },     // Temperature sensor
+	{  0, ADC_SMP_640_5 }      // VREFINT
+};
+
+static volatile int32_t  ADC_Temperature_cC;   // 0.01 degC
+static volatile uint32_t ADC_VBAT_mV;
+
+static void ADC_Sensors_Done(const uint16_t *results, uint32_t length){
+	int32_t ts, cal1, cal2;
+	uint32_t vbat, vts;
+	
+	if (length != 4)
+		return;
+	
+	// 12-bit right-aligned LSB, as the factory values
+	vbat = ADC_Injected_12bit(results[1]);
+	vts  = ADC_Injected_12bit(results[2]);
+	ADC_VDDA_From_VREFINT(ADC_Injected_12bit(results[3]));
+	
+	ts   = (int32_t) ((vts * ADC_VDDA_mV + VREFINT_CAL_VREF / 2) / VREFINT_CAL_VREF);
+	cal1 = *TS_CAL1_ADDR;
+	cal2 = *TS_CAL2_ADDR;
+	if (cal2 != cal1)
+		ADC_Temperature_cC = (TS_CAL2_TEMP - TS_CAL1_TEMP) * 100 * (ts - cal1) / (cal2 - cal1) + TS_CAL1_TEMP * 100;
+	
+	ADC_VBAT_mV = (3 * vbat * ADC_VDDA_mV + ADC_FULL_SCALE / 2) / ADC_FULL_SCALE;
+}
+
+// TSEN and VBATEN are writable only when all the ADCs of the common group are disabled
+// (ADC3 is not used here). ADC1 and ADC2 are enabled again if they were.
+static void ADC_Sensors_Switch(uint32_t on){
+	uint32_t adc1, adc2;
+	
+	adc1 = ADC1->CR & ADC_CR_ADEN;
+	adc2 = ADC2->CR & ADC_CR_ADEN;
+	ADC_Disable(ADC1);
+	ADC_Disable(ADC2);
+	
+	if (on)
+		ADC123_COMMON->CCR |= ADC_CCR_TSEN | ADC_CCR_VBATEN;
+	else
+		ADC123_COMMON->CCR &= ~(ADC_CCR_TSEN | ADC_CCR_VBATEN);
+	
+	if (adc2)
+		ADC_Enable(ADC2);
+	if (adc1)
+		ADC_Enable(ADC1);
+}
+
+void ADC_Sensors_Start(uint32_t rate){
+	ADC_Injected_Stop();                  // ADDIS needs JADSTART=0
+	ADC_Sensors_Switch(1);
+	ADC_Injected_Config(ADC_Sensors_Sequence, 4, ADC_JTRIGGER_TIM6_TRGO, ADC_TRIGGER_RISING);
+	ADC_Injected_Start(ADC_Sensors_Done);
+	TIM6_Init(rate);
+}
+
+void ADC_Sensors_Stop(void){
+	TIM6_Stop();
+	ADC_Injected_Stop();
+	ADC_Sensors_Switch(0);
+}
+
+// Last temperature in 0.01 degC
+int32_t ADC_Temperature(void){
+	return ADC_Temperature_cC;
+}
+
+// Last VBAT in mV
+uint32_t ADC_VBAT(void){
+	return ADC_VBAT_mV;
+}
+
+// ******************************************************************************************
+// Conversion to millivolts at the last measured VDDA (kernel in Millivolts.c)
+//  Unsigned right-aligned regular results at the programmed resolution and regular
+//  oversampling: the scale is computed for their full-scale code on every call.
+//  samples and millivolts may be the same buffer.
+// ******************************************************************************************
+void ADC_To_Millivolts(const uint16_t *samples, uint16_t *millivolts, uint32_t length){
+	Millivolts_Convert(samples, millivolts, length, Millivolts_Scale(ADC_VDDA_mV, ADC_Regular_Full_Scale()));
+}
@@ -4,6 +4,120 @@
 #include "stm32l476xx.h"
 
 #define  ADC_SAMPLE_SIZE 100
+#define  ADC_RING_SIZE   256     // Interrupt-driven sample ring, must be a power of 2
+#define  ADC_ERRATA_GAP_US  1000U  // 1 ms (see errata in ADC.c)
+
+// RTC backup registers reserved for the cached ADC calibration
+#define  ADC_CALIBRATION_KEY     0xADCCA100U
+#define  ADC_BKP_KEY_REG         (RTC->BKP0R)
+#define  ADC_BKP_CALFACT_REG     (RTC->BKP1R)
+
+// VREFINT factory calibration, raw data acquired at VDDA = 3.0 V (datasheet, 3.15.1)
+#define  VREFINT_CAL_ADDR        ((uint16_t *) 0x1FFF75AAU)
+#define  VREFINT_CAL_VREF        3000U   // mV
+#define  ADC_FULL_SCALE          4095U   // 12-bit, right aligned
+
+// Temperature sensor factory calibration, raw data acquired at VDDA = 3.0 V (datasheet, 3.15.2)
+#define  TS_CAL1_ADDR            ((uint16_t *) 0x1FFF75A8U)
+#define  TS_CAL2_ADDR            ((uint16_t *) 0x1FFF75CAU)
+#define  TS_CAL1_TEMP            30      // degC
+#define  TS_CAL2_TEMP            110     // degC
+
+// ADC sample time (SMPx), in ADC clock cycles
+#define  ADC_SMP_2_5              0U
+#define  ADC_SMP_6_5              1U
+#define  ADC_SMP_12_5             2U
+#define  ADC_SMP_24_5             3U
+#define  ADC_SMP_47_5             4U
+#define  ADC_SMP_92_5             5U
+#define  ADC_SMP_247_5            6U
+#define  ADC_SMP_640_5            7U
+
+// ADC resolution (RES)
+#define  ADC_RES_12               0U
+#define  ADC_RES_10               1U
+#define  ADC_RES_8                2U
+#define  ADC_RES_6                3U
+#define  ADC_RES_NONE             0xFFU    // ADC_Policy_Select: target not reachable
+
+#define  ADC_Q15_MIDSCALE         2048U      // Offset for DC-free signed samples of a mid-biased input
+
+// One rank of a scan sequence
+typedef struct {
+	uint32_t channel;       // ADC channel number, e.g. 6 = PA1 (ADC12_IN6)
+	uint32_t sample_time;   // ADC_SMP_xxx
+} ADC_Channel;
+
+// Oversampling mode, see ADC_Oversampling_Config()
+#define  ADC_OVS_REGULAR          ADC_CFGR2_ROVSE
+#define  ADC_OVS_INJECTED         ADC_CFGR2_JOVSE
+#define  ADC_OVS_TRIGGERED        ADC_CFGR2_TROVS
+#define  ADC_OVS_RESUMED          ADC_CFGR2_ROVSM
+
+// Called from ADC1_2_IRQHandler when analog watchdog 1, 2 or 3 fires
+typedef void (*ADC_AWD_Callback)(uint32_t watchdog);
+
+// Settings of one analog watchdog, see ADC_AWD_Save() / ADC_AWD_Restore()
+typedef struct {
+	ADC_AWD_Callback callback;
+	uint32_t config;          // AWD1 bits of CFGR, or AWD2CR / AWD3CR
+	uint32_t thresholds;      // TR1, TR2 or TR3
+	uint32_t armed;           // AWDxIE
+} ADC_AWD_Settings;
+
+// Regular group external trigger selection (EXTSEL)
+#define  ADC_TRIGGER_TIM1_CC1     0U
+#define  ADC_TRIGGER_TIM1_CC2     1U
+#define  ADC_TRIGGER_TIM1_CC3     2U
+#define  ADC_TRIGGER_TIM2_CC2     3U
+#define  ADC_TRIGGER_TIM3_TRGO    4U
+#define  ADC_TRIGGER_TIM4_CC4     5U
+#define  ADC_TRIGGER_EXTI11       6U
+#define  ADC_TRIGGER_TIM8_TRGO    7U
+#define  ADC_TRIGGER_TIM8_TRGO2   8U
+#define  ADC_TRIGGER_TIM1_TRGO    9U
+#define  ADC_TRIGGER_TIM1_TRGO2   10U
+#define  ADC_TRIGGER_TIM2_TRGO    11U
+#define  ADC_TRIGGER_TIM4_TRGO    12U
+#define  ADC_TRIGGER_TIM6_TRGO    13U
+#define  ADC_TRIGGER_TIM15_TRGO   14U
+#define  ADC_TRIGGER_TIM3_CC4     15U
+
+// Regular group external trigger polarity (EXTEN)
+#define  ADC_TRIGGER_SOFTWARE     0U
+#define  ADC_TRIGGER_RISING       1U
+#define  ADC_TRIGGER_FALLING      2U
+#define  ADC_TRIGGER_BOTH         3U
+
+// Injected group external trigger source (JEXTSEL)
+#define  ADC_JTRIGGER_TIM1_TRGO   0U
+#define  ADC_JTRIGGER_TIM1_CC4    1U
+#define  ADC_JTRIGGER_TIM2_TRGO   2U
+#define  ADC_JTRIGGER_TIM2_CC1    3U
+#define  ADC_JTRIGGER_TIM3_CC4    4U
+#define  ADC_JTRIGGER_TIM4_TRGO   5U
+#define  ADC_JTRIGGER_EXTI15      6U
+#define  ADC_JTRIGGER_TIM8_CC4    7U
+#define  ADC_JTRIGGER_TIM1_TRGO2  8U
+#define  ADC_JTRIGGER_TIM8_TRGO   9U
+#define  ADC_JTRIGGER_TIM8_TRGO2  10U
+#define  ADC_JTRIGGER_TIM3_CC3    11U
+#define  ADC_JTRIGGER_TIM3_TRGO   12U
+#define  ADC_JTRIGGER_TIM3_CC1    13U
+#define  ADC_JTRIGGER_TIM6_TRGO   14U
+#define  ADC_JTRIGGER_TIM15_TRGO  15U
+// Injected group trigger polarity (JEXTEN): ADC_TRIGGER_SOFTWARE/RISING/FALLING/BOTH
+
+// Called from ADC1_2_IRQHandler at the end of the injected sequence with JDR1..JDRn
+typedef void (*ADC_Injected_Callback)(const uint16_t *results, uint32_t length);
+
+// Called from the DMA interrupt with the half of the circular buffer that is ready
+typedef void (*ADC_DMA_Callback)(uint16_t *samples, uint32_t length);
+
+// Dual mode: one 32-bit word per pair, as read from ADC123_COMMON->CDR
+typedef void (*ADC_Dual_Callback)(uint32_t *pairs, uint32_t length);
+#define  ADC_DUAL_MASTER(pair)    ((uint16_t) ((pair) & 0xFFFFU))   // ADC1 result
+#define  ADC_DUAL_SLAVE(pair)     ((uint16_t) ((pair) >> 16))       // ADC2 result
 
 void ADC_Init(void);
 
@@ -11,6 +125,72 @@ void ADC_Wakeup (void);
 void ADC_Init(void);
 
 void ADC_Pin_Init(void);
+void ADC_Calibrate(void);
+uint32_t ADC_Calibration_Load(uint32_t *calfact);
+uint32_t ADC_Calibration_Cycles(void);
+uint32_t ADC_Calibration_Restored(void);
 void ADC_Common_Configuration(void);
 
+uint16_t ADC_Read(void);
+uint32_t ADC_Dummy_Count(void);
+void ADC_Errata_Reset(void);
+
+void ADC_Scan_Config(const ADC_Channel *sequence, uint32_t length);
+void ADC_Scan_Deinterleave(const uint16_t *samples, uint32_t length, uint16_t * const *channels, uint32_t count);
+
+void ADC_Oversampling_Config(uint32_t ratio, uint32_t shift, uint32_t mode);
+void ADC_Oversampling_Disable(void);
+void ADC_Resolution_Config(uint32_t resolution);
+uint32_t ADC_Conversion_Half_Cycles(uint32_t resolution, uint32_t sample_time);
+uint32_t ADC_Clock_Frequency(void);
+uint32_t ADC_Max_Sample_Rate(const ADC_Channel *sequence, uint32_t length, uint32_t resolution);
+uint32_t ADC_Policy_Select(const ADC_Channel *sequence, uint32_t length, uint32_t target_rate, ADC_Channel *selected);
+void ADC_Policy_Apply(const ADC_Channel *selected, uint32_t length, uint32_t resolution);
+void ADC_Offset_Config(uint32_t index, uint32_t channel, uint32_t offset);
+void ADC_Offset_Disable(uint32_t index);
+void ADC_Q15_Config(const ADC_Channel *sequence, uint32_t length, uint32_t offset);
+void ADC_Q15_Disable(void);
+
+void ADC_Trigger_Config(uint32_t source, uint32_t edge);
+void ADC_Timer_Trigger_Init(uint32_t sample_rate);
+void ADC_Set_Sample_Rate(uint32_t sample_rate);
+
+void ADC_DMA_Start(uint16_t *buffer, uint32_t length, ADC_DMA_Callback half, ADC_DMA_Callback full);
+void ADC_DMA_Stop(void);
+void ADC_DMA_Restart(void);
+uint32_t ADC_DMA_Position(void);
+
+void ADC_Dual_Init(uint32_t master_channel, uint32_t slave_channel, uint32_t sample_time);
+void ADC_Dual_DMA_Start(uint32_t *buffer, uint32_t length, ADC_Dual_Callback half, ADC_Dual_Callback full);
+uint32_t ADC_Dual_Read(uint32_t *pairs, uint32_t max);
+
+void ADC_IRQ_Start(void);
+void ADC_IRQ_Stop(void);
+void ADC_Ring_Push(uint16_t sample);
+uint32_t ADC_Ring_Read(uint16_t *samples, uint32_t max);
+uint32_t ADC_Ring_Count(void);
+uint32_t ADC_Ring_Dropped_Count(void);
+uint32_t ADC_Ring_Overrun_Count(void);
+
+void ADC_AWD_Config(uint32_t watchdog, uint32_t channel, uint32_t low, uint32_t high, ADC_AWD_Callback callback);
+void ADC_AWD_Arm(uint32_t watchdog);
+void ADC_AWD_Disarm(uint32_t watchdog);
+void ADC_AWD_Disable(uint32_t watchdog);
+void ADC_AWD_Save(uint32_t watchdog, ADC_AWD_Settings *settings);
+void ADC_AWD_Restore(uint32_t watchdog, const ADC_AWD_Settings *settings);
+void ADC_Monitor_Start(void);
+
+void ADC1_2_IRQHandler(void);
+void ADC_Injected_Config(const ADC_Channel *sequence, uint32_t length, uint32_t source, uint32_t edge);
+void ADC_Injected_Auto(uint32_t enable);
+void ADC_Injected_Start(ADC_Injected_Callback callback);
+void ADC_Injected_Stop(void);
+uint32_t ADC_VDDA_Update(void);
+void ADC_Sensors_Start(uint32_t rate);
+void ADC_Sensors_Stop(void);
+int32_t ADC_Temperature(void);
+uint32_t ADC_VBAT(void);
+uint32_t ADC_VDDA(void);
+void ADC_To_Millivolts(const uint16_t *samples, uint16_t *millivolts, uint32_t length);
+
 #endif /* __STM32L476G_DISCOVERY_ADC_H */
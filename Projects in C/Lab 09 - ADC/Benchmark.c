@@ -0,0 +1,452 @@
+#include "Benchmark.h"
+#include "ADC.h"
+#include "SysTimer.h"
+#include "SysClock.h"
+#include "Decimator.h"
+#include "Stats.h"
+#include "FFT.h"
+#include "Codec.h"
+#include "stm32l476xx.h"
+#include <stdint.h>
+#include <math.h>
+
+// ******************************************************************************************
+// On-target benchmarks
+// Cycles are counted with the DWT cycle counter (CYCCNT) at the core clock (80 MHz).
+// Run them after ADC_Init() and before ADC_DMA_Start(); they leave ADC1 in single
+// software-triggered conversion of PA1 (ADC12_IN6) with oversampling disabled.
+// Read the result structures in the debugger watch window.
+// ******************************************************************************************
+void Benchmark_Init(void){
+	Cycle_Counter_Init();
+}
+
+// One software-triggered conversion of the regular group
+static uint32_t Benchmark_Convert(void){
+	ADC1->CR |= ADC_CR_ADSTART;
+	while ((ADC1->ISR & ADC_ISR_EOC) == 0);
+	return ADC1->DR;              // Reading DR clears EOC
+}
+
+// Standard deviation of n results
+static float Benchmark_Deviation(const uint32_t *data, uint32_t n){
+	uint32_t i;
+	float mean, d, sum;
+	
+	sum = 0;
+	for (i = 0; i < n; i++)
+		sum += (float) data[i];
+	mean = sum / n;
+	
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		d = (float) data[i] - mean;
+		sum += d * d;
+	}
+	return sqrtf(sum / n);
+}
+
+// ******************************************************************************************
+// Hardware oversampling (256x, shift 4) versus software averaging of 256 conversions.
+// Both produce a 16-bit result from the same number of 12-bit conversions.
+// Hardware: the CPU only starts the burst and reads DR; it could sleep while the ADC converts,
+//           so the wait is not counted.
+// Software: the CPU starts, polls and accumulates every single conversion.
+// ******************************************************************************************
+void Benchmark_Oversampling(Benchmark_Oversampling_Result *result){
+	static uint32_t data[BENCHMARK_RESULTS];
+	uint32_t i, k, sum, start, cycles;
+	ADC_Channel channel;
+	
+	Benchmark_Init();
+	ADC_DMA_Stop();
+	ADC_Trigger_Config(0, ADC_TRIGGER_SOFTWARE);
+	channel.channel = 6;                    // PA1: ADC12_IN6
+	channel.sample_time = ADC_SMP_24_5;
+	ADC_Scan_Config(&channel, 1);
+	
+	result->ratio = 256;
+	
+	// Hardware oversampling
+	ADC_Oversampling_Config(256, 4, ADC_OVS_REGULAR);
+	cycles = 0;
+	for (i = 0; i < BENCHMARK_RESULTS; i++) {
+		start = DWT->CYCCNT;
+		ADC1->CR |= ADC_CR_ADSTART;
+		cycles += DWT->CYCCNT - start;
+		
+		while ((ADC1->ISR & ADC_ISR_EOC) == 0);   // The CPU is free during the burst
+		
+		start = DWT->CYCCNT;
+		data[i] = ADC1->DR;
+		cycles += DWT->CYCCNT - start;
+	}
+	result->cycles_hardware = cycles / BENCHMARK_RESULTS;
+	result->noise_hardware  = Benchmark_Deviation(data, BENCHMARK_RESULTS);
+	
+	// Software averaging
+	ADC_Oversampling_Disable();
+	start = DWT->CYCCNT;
+	for (i = 0; i < BENCHMARK_RESULTS; i++) {
+		sum = 0;
+		for (k = 0; k < 256; k++)
+			sum += Benchmark_Convert();
+		data[i] = sum >> 4;   // Same scaling as the hardware: 20-bit sum -> 16 bits
+	}
+	result->cycles_software = (DWT->CYCCNT - start) / BENCHMARK_RESULTS;
+	result->noise_software  = Benchmark_Deviation(data, BENCHMARK_RESULTS);
+}
+
+// ******************************************************************************************
+// Throughput of the sample ring, producer and consumer run back-to-back on the CPU.
+// The interrupt-driven acquisition must be stopped (ADC_IRQ_Stop) while this runs.
+// Pushes a counting sequence half a ring at a time and drains it in batches, checking
+// that every sample comes out once and in order.
+// ******************************************************************************************
+void Benchmark_Ring(Benchmark_Ring_Result *result){
+	static uint16_t batch[32];
+	uint32_t i, k, n, start, push, read;
+	uint16_t expected, value;
+	
+	Benchmark_Init();
+	
+	// Empty the ring
+	while (ADC_Ring_Read(batch, 32) != 0);
+	
+	result->samples = 0;
+	result->batch = 32;
+	result->errors = 0;
+	push = 0;
+	read = 0;
+	value = 0;
+	expected = 0;
+	
+	for (k = 0; k < 64; k++) {
+		start = DWT->CYCCNT;
+		for (i = 0; i < ADC_RING_SIZE / 2; i++)
+			ADC_Ring_Push(value++);
+		push += DWT->CYCCNT - start;
+		
+		do {
+			start = DWT->CYCCNT;
+			n = ADC_Ring_Read(batch, 32);
+			read += DWT->CYCCNT - start;
+			
+			for (i = 0; i < n; i++) {
+				if (batch[i] != expected)
+					result->errors++;
+				expected = batch[i] + 1;
+			}
+			result->samples += n;
+		} while (n != 0);
+	}
+	
+	result->cycles_push = push / result->samples;
+	result->cycles_read = read / result->samples;
+}
+
+// ******************************************************************************************
+// Millivolt conversion: Q16 integer kernel versus float (mV = DATA * VDDA / 4095).
+// Every 12-bit code is converted once; the float result is also the exact value used to
+// measure the error of the integer kernel. Throughput in samples per second is
+// 80 MHz / cycles per sample. Needs the ADC enabled (ADC_Init) for the VDDA measurement.
+// ******************************************************************************************
+void Benchmark_Millivolts(Benchmark_Millivolts_Result *result){
+	static uint16_t codes[ADC_FULL_SCALE + 1];
+	static uint16_t fixed[ADC_FULL_SCALE + 1];
+	static float exact[ADC_FULL_SCALE + 1];
+	uint32_t i, start;
+	float scale, error, sum;
+	
+	Benchmark_Init();
+	
+	result->vdda = ADC_VDDA_Update();
+	result->samples = ADC_FULL_SCALE + 1;
+	for (i = 0; i <= ADC_FULL_SCALE; i++)
+		codes[i] = (uint16_t) i;
+	
+	start = DWT->CYCCNT;
+	ADC_To_Millivolts(codes, fixed, ADC_FULL_SCALE + 1);
+	result->cycles_fixed = (DWT->CYCCNT - start) / result->samples;
+	
+	start = DWT->CYCCNT;
+	scale = (float) result->vdda / (float) ADC_FULL_SCALE;
+	for (i = 0; i <= ADC_FULL_SCALE; i++)
+		exact[i] = (float) codes[i] * scale;
+	result->cycles_float = (DWT->CYCCNT - start) / result->samples;
+	
+	result->error_max = 0;
+	sum = 0;
+	for (i = 0; i <= ADC_FULL_SCALE; i++) {
+		error = fabsf((float) fixed[i] - exact[i]);
+		if (error > result->error_max)
+			result->error_max = error;
+		sum += error;
+	}
+	result->error_mean = sum / result->samples;
+}
+
+// ******************************************************************************************
+// Decimation pipeline throughput (does not use the ADC).
+// A constant input of 3000 is processed in blocks of ADC_SAMPLE_SIZE / 2 samples, the size of
+// one de-interleaved DMA half-buffer. Once the pipeline has settled every output must be
+// exactly (3000 - 2048) * 16; the outputs that are not are counted in errors.
+// ******************************************************************************************
+void Benchmark_Decimator(Benchmark_Decimator_Result *result){
+	static Decimator dec;
+	static uint16_t input[2048];
+	static int16_t output[2048 / 32 + 1];
+	uint32_t i, n, block, start, cycles;
+	
+	Benchmark_Init();
+	
+	Decimator_Init(&dec, 4, 16, Decimator_CIC4_R16_FIR, DECIMATOR_CIC4_R16_TAPS, 2);
+	for (i = 0; i < 2048; i++)
+		input[i] = 3000;
+	
+	result->samples = 2048;
+	result->outputs = 0;
+	cycles = 0;
+	for (i = 0; i < 2048; i += block) {
+		block = ADC_SAMPLE_SIZE / 2;
+		if (block > 2048 - i)
+			block = 2048 - i;
+		start = DWT->CYCCNT;
+		n = Decimator_Process(&dec, &input[i], block, &output[result->outputs]);
+		cycles += DWT->CYCCNT - start;
+		result->outputs += n;
+	}
+	result->cycles = cycles / result->samples;
+	result->samples_per_second = (uint32_t) ((uint64_t) result->samples * System_Clock_Frequency() / cycles);
+	
+	// The CIC settles after N outputs and the FIR after its length
+	result->errors = 0;
+	for (i = 4 + DECIMATOR_CIC4_R16_TAPS; i < result->outputs; i++)
+		if (output[i] != (3000 - 2048) * 16)
+			result->errors++;
+}
+
+// ******************************************************************************************
+// Block statistics, SIMD versus plain C, on 1024 pseudo-random 12-bit samples (no ADC).
+// Both versions are also run on shorter blocks starting on odd samples, which exercises the
+// unaligned head and the tail of the SIMD loop; any difference is counted in errors.
+// ******************************************************************************************
+void Benchmark_Stats(Benchmark_Stats_Result *result){
+	static uint16_t samples[1024];
+	Stats_Result simd, portable;
+	uint32_t i, seed, start;
+	
+	Benchmark_Init();
+	
+	seed = 1;
+	for (i = 0; i < 1024; i++) {
+		seed = seed * 1664525U + 1013904223U;   // Linear congruential generator
+		samples[i] = (uint16_t) (seed >> 20);
+	}
+	
+	result->samples = 1024;
+	
+	start = DWT->CYCCNT;
+	Stats_Block(samples, 1024, &simd);
+	result->cycles_simd = (DWT->CYCCNT - start) / 1024;
+	
+	start = DWT->CYCCNT;
+	Stats_Block_Portable(samples, 1024, &portable);
+	result->cycles_portable = (DWT->CYCCNT - start) / 1024;
+	
+	result->errors = 0;
+	for (i = 0; i < 16; i++) {
+		Stats_Block(&samples[i], 1024 - 3 * i, &simd);
+		Stats_Block_Portable(&samples[i], 1024 - 3 * i, &portable);
+		if (simd.min != portable.min || simd.max != portable.max ||
+		    simd.mean != portable.mean || simd.rms != portable.rms)
+			result->errors++;
+	}
+}
+
+// ******************************************************************************************
+// FFT cycles (no ADC). A 12-bit tone exactly on bin 100 is analysed twice: FFT_Q15 alone on
+// the windowed data, then the whole FFT_Spectrum. The FFT has no data-dependent branches,
+// so cycles_fft is the bound for any 1024-point input.
+// ******************************************************************************************
+void Benchmark_FFT(Benchmark_FFT_Result *result){
+	static uint16_t samples[FFT_SIZE];
+	static int16_t data[2 * FFT_SIZE];
+	static uint16_t magnitude[FFT_BINS];
+	FFT_Peak peak;
+	uint32_t i, start;
+	
+	Benchmark_Init();
+	
+	result->points = FFT_SIZE;
+	result->bin_expected = 100;
+	for (i = 0; i < FFT_SIZE; i++)
+		samples[i] = (uint16_t) (2048.0f + 1500.0f * sinf(6.2831853f * 100.0f * i / FFT_SIZE));
+	
+	FFT_Window(samples, data);
+	start = DWT->CYCCNT;
+	FFT_Q15(data);
+	result->cycles_fft = DWT->CYCCNT - start;
+	
+	start = DWT->CYCCNT;
+	FFT_Spectrum(samples, FFT_SIZE, magnitude, &peak);
+	result->cycles_spectrum = DWT->CYCCNT - start;
+	result->bin = peak.bin;
+}
+
+// ******************************************************************************************
+// Sustained throughput: PA1 in continuous mode, circular DMA into 1024 samples.
+// The cycles between the half-transfer and the transfer-complete interrupts cover exactly
+// 512 conversions, so the start-up and the interrupt latency are not counted.
+// With OVRMOD = 0 an overrun ends the DMA requests and the transfer never completes: the
+// wait gives up after BENCHMARK_TIMEOUT_MS (DWT cycles) and the OVR flag is recorded.
+// Leaves ADC1 stopped, 12-bit, with PA1 as a one-channel sequence at 24.5 cycles.
+// ******************************************************************************************
+static volatile uint32_t Benchmark_Half_Time, Benchmark_Full_Time, Benchmark_Done;
+
+static void Benchmark_Half(uint16_t *samples, uint32_t length){
+	(void) samples;
+	(void) length;
+	Benchmark_Half_Time = DWT->CYCCNT;
+}
+
+static void Benchmark_Full(uint16_t *samples, uint32_t length){
+	(void) samples;
+	(void) length;
+	Benchmark_Full_Time = DWT->CYCCNT;
+	Benchmark_Done = 1;
+}
+
+void Benchmark_Throughput(Benchmark_Throughput_Result results[BENCHMARK_CONFIGURATIONS]){
+	static uint16_t buffer[1024];
+	ADC_Channel channel;
+	uint32_t resolution, sample_time, n, start, timeout;
+	
+	Benchmark_Init();
+	ADC_DMA_Stop();
+	ADC_Trigger_Config(0, ADC_TRIGGER_SOFTWARE);
+	channel.channel = 6;                    // PA1: ADC12_IN6
+	timeout = System_Clock_Frequency() / 1000 * BENCHMARK_TIMEOUT_MS;
+	
+	n = 0;
+	for (resolution = ADC_RES_12; resolution <= ADC_RES_6; resolution++) {
+		for (sample_time = ADC_SMP_2_5; sample_time <= ADC_SMP_640_5; sample_time++) {
+			channel.sample_time = sample_time;
+			ADC_Policy_Apply(&channel, 1, resolution);
+			
+			Benchmark_Done = 0;
+			start = DWT->CYCCNT;
+			ADC_DMA_Start(buffer, 1024, Benchmark_Half, Benchmark_Full);
+			while (Benchmark_Done == 0 && DWT->CYCCNT - start < timeout);
+			results[n].overrun = (ADC1->ISR & ADC_ISR_OVR) == ADC_ISR_OVR;
+			ADC_DMA_Stop();
+			ADC1->ISR = ADC_ISR_OVR;
+			
+			results[n].resolution = resolution;
+			results[n].sample_time = sample_time;
+			results[n].expected = ADC_Max_Sample_Rate(&channel, 1, resolution);
+			if (Benchmark_Done != 0)
+				results[n].measured = (uint32_t) ((uint64_t) 512 * System_Clock_Frequency()
+				                                  / (Benchmark_Full_Time - Benchmark_Half_Time));
+			else
+				results[n].measured = 0;
+			n++;
+		}
+	}
+	
+	channel.sample_time = ADC_SMP_24_5;
+	ADC_Policy_Apply(&channel, 1, ADC_RES_12);
+}
+
+// ******************************************************************************************
+// Codec (no ADC). One 512-sample block of each waveform, 12-bit, sampled at 10 kHz:
+//   0: quiet DC        2048 + 0..3 LSB of noise (an idle input)
+//   1: sine            100 Hz, 1500 LSB amplitude, + 0..3 LSB of noise
+//   2: square          100 Hz, 100 / 4000
+//   3: noise           full-scale 12-bit random, the worst case for a delta codec
+// ******************************************************************************************
+void Benchmark_Codec(Benchmark_Codec_Result results[BENCHMARK_WAVEFORMS]){
+	static uint16_t samples[512], decoded[512];
+	static uint8_t encoded[CODEC_MAX_BYTES(512)];
+	uint32_t i, waveform, seed, noise, start, length;
+	
+	Benchmark_Init();
+	
+	seed = 1;
+	for (waveform = 0; waveform < BENCHMARK_WAVEFORMS; waveform++) {
+		for (i = 0; i < 512; i++) {
+			seed = seed * 1664525U + 1013904223U;   // Linear congruential generator
+			noise = seed >> 30;
+			if (waveform == 0)
+				samples[i] = (uint16_t) (2048 + noise);
+			else if (waveform == 1)
+				samples[i] = (uint16_t) (2048.0f + 1500.0f * sinf(6.2831853f * 100.0f * i / 10000.0f) + noise);
+			else if (waveform == 2)
+				samples[i] = (uint16_t) ((i / 50) & 1 ? 4000 : 100);
+			else
+				samples[i] = (uint16_t) (seed >> 20);
+		}
+		
+		results[waveform].samples = 512;
+		
+		start = DWT->CYCCNT;
+		results[waveform].bytes = Codec_Encode(samples, 512, encoded, sizeof(encoded));
+		results[waveform].cycles_encode = (DWT->CYCCNT - start) / 512;
+		results[waveform].ratio = 2.0f * 512 / results[waveform].bytes;
+		
+		start = DWT->CYCCNT;
+		Codec_Decode(encoded, results[waveform].bytes, decoded, 512, &length);
+		results[waveform].cycles_decode = (DWT->CYCCNT - start) / 512;
+		
+		results[waveform].errors = (length == 512) ? 0 : 512;
+		for (i = 0; i < length; i++)
+			if (decoded[i] != samples[i])
+				results[waveform].errors++;
+	}
+}
+
+// ******************************************************************************************
+// Calibration: start-up latency and offset error
+// channel 0 (VREFINT) is compared with its factory reading VREFINT_CAL, which is valid at
+// VDDA = 3.0 V (the supply of the Discovery board). Any other channel must be tied to GND
+// and is compared with 0; a negative offset then clips at code 0, so VREFINT is preferred.
+// The offset is measured with CALFACT_S cleared and with the CALFACT that ADC_Init() wrote
+// (restored on a warm boot, fresh on a cold boot), BENCHMARK_RESULTS conversions each.
+// ******************************************************************************************
+static float Benchmark_Mean(uint32_t n){
+	uint32_t i, sum;
+	
+	sum = 0;
+	for (i = 0; i < n; i++)
+		sum += Benchmark_Convert();
+	return (float) sum / n;
+}
+
+void Benchmark_Calibration(uint32_t channel, Benchmark_Calibration_Result *result){
+	uint32_t calfact;
+	ADC_Channel input;
+	
+	Benchmark_Init();
+	ADC_DMA_Stop();
+	ADC_Trigger_Config(0, ADC_TRIGGER_SOFTWARE);
+	ADC_Oversampling_Disable();
+	input.channel = channel;
+	input.sample_time = ADC_SMP_640_5;      // VREFINT needs at least 4 us
+	ADC_Scan_Config(&input, 1);
+	
+	result->warm = ADC_Calibration_Restored();
+	result->cycles_startup = ADC_Calibration_Cycles();
+	result->reference = (channel == 0) ? *VREFINT_CAL_ADDR : 0;
+	
+	// CALFACT is writable only when ADEN=1, ADSTART=0 and JADSTART=0
+	calfact = ADC1->CALFACT;
+	result->calfact = calfact & ADC_CALFACT_CALFACT_S;
+	ADC1->CALFACT = calfact & ~ADC_CALFACT_CALFACT_S;
+	result->offset_none = Benchmark_Mean(BENCHMARK_RESULTS) - (float) result->reference;
+	ADC1->CALFACT = calfact;
+	result->offset_calibrated = Benchmark_Mean(BENCHMARK_RESULTS) - (float) result->reference;
+	
+	input.channel = 6;                      // Back to PA1: ADC12_IN6
+	input.sample_time = ADC_SMP_24_5;
+	ADC_Scan_Config(&input, 1);
+}
@@ -0,0 +1,110 @@
+#ifndef __STM32L476G_DISCOVERY_BENCHMARK_H
+#define __STM32L476G_DISCOVERY_BENCHMARK_H
+
+#include "stm32l476xx.h"
+
+#define  BENCHMARK_RESULTS   64     // Number of 16-bit results used to estimate the noise floor
+
+// Oversampling versus software averaging of the same number of conversions
+typedef struct {
+	uint32_t ratio;              // Conversions per 16-bit result
+	uint32_t cycles_hardware;    // CPU cycles per result, hardware oversampling
+	uint32_t cycles_software;    // CPU cycles per result, software averaging
+	float    noise_hardware;     // Standard deviation of the results in 16-bit LSB
+	float    noise_software;     // Standard deviation of the results in 16-bit LSB
+} Benchmark_Oversampling_Result;
+
+// Interrupt-driven sample ring (ADC_Ring_Push / ADC_Ring_Read)
+typedef struct {
+	uint32_t samples;            // Samples pushed and read
+	uint32_t batch;              // Samples per ADC_Ring_Read() call
+	uint32_t cycles_push;        // CPU cycles per ADC_Ring_Push()
+	uint32_t cycles_read;        // CPU cycles per sample read
+	uint32_t errors;             // Samples read out of order (must be 0)
+} Benchmark_Ring_Result;
+
+// ADC_To_Millivolts versus a float reference, over all 4096 codes
+typedef struct {
+	uint32_t vdda;               // mV, from ADC_VDDA_Update()
+	uint32_t samples;            // Samples converted per run
+	uint32_t cycles_fixed;       // CPU cycles per sample, ADC_To_Millivolts (Q16)
+	uint32_t cycles_float;       // CPU cycles per sample, float reference
+	float    error_max;          // Largest |fixed - exact| in mV
+	float    error_mean;         // Mean |fixed - exact| in mV
+} Benchmark_Millivolts_Result;
+
+// Decimator_Process on a 4-stage CIC (R = 16) and the 21-tap compensator (D = 2)
+typedef struct {
+	uint32_t samples;            // Input samples per run
+	uint32_t outputs;            // Output samples per run
+	uint32_t cycles;             // CPU cycles per input sample
+	uint32_t samples_per_second; // Input throughput at the current HCLK
+	uint32_t errors;             // Settled outputs of a constant input that are not exact
+} Benchmark_Decimator_Result;
+
+// Stats_Block (SIMD when __ARM_FEATURE_DSP) versus Stats_Block_Portable
+typedef struct {
+	uint32_t samples;            // Samples per block
+	uint32_t cycles_simd;        // CPU cycles per sample, Stats_Block
+	uint32_t cycles_portable;    // CPU cycles per sample, Stats_Block_Portable
+	uint32_t errors;             // Blocks where the two results differ (must be 0)
+} Benchmark_Stats_Result;
+
+// FFT_Q15 and FFT_Spectrum on a synthetic tone
+typedef struct {
+	uint32_t points;             // FFT_SIZE
+	uint32_t cycles_fft;         // CPU cycles of FFT_Q15 alone
+	uint32_t cycles_spectrum;    // CPU cycles of window + FFT + magnitudes + peak search
+	uint32_t bin_expected;       // Bin of the tone
+	uint32_t bin;                // Dominant bin found (must equal bin_expected)
+} Benchmark_FFT_Result;
+
+// Sustained conversion rate of one channel for every resolution and sample time
+typedef struct {
+	uint32_t resolution;         // ADC_RES_xx
+	uint32_t sample_time;        // ADC_SMP_xxx
+	uint32_t expected;           // Samples per second, ADC_Max_Sample_Rate()
+	uint32_t measured;           // Samples per second, ADC continuous mode + circular DMA
+	                             // (0: no transfer complete within BENCHMARK_TIMEOUT_MS)
+	uint32_t overrun;            // 1: OVR set, the DMA did not keep up and stopped its requests
+} Benchmark_Throughput_Result;
+
+#define  BENCHMARK_TIMEOUT_MS       100   // Longest wait for one 1024-sample buffer
+
+#define  BENCHMARK_CONFIGURATIONS   32    // 4 resolutions x 8 sample times
+
+// Codec_Encode / Codec_Decode on synthetic 12-bit blocks
+typedef struct {
+	uint32_t samples;            // Samples per block
+	uint32_t bytes;              // Encoded size (raw: 2 * samples)
+	float    ratio;              // Raw size / encoded size
+	uint32_t cycles_encode;      // CPU cycles per sample, Codec_Encode
+	uint32_t cycles_decode;      // CPU cycles per sample, Codec_Decode
+	uint32_t errors;             // Samples that do not round-trip (must be 0)
+} Benchmark_Codec_Result;
+
+#define  BENCHMARK_WAVEFORMS        4     // Quiet DC, sine, square, full-scale noise
+
+// Start-up cost of the calibration in ADC_Init() and the offset it removes
+typedef struct {
+	uint32_t warm;               // 1: ADC_Init() restored the cached CALFACT, 0: it calibrated
+	uint32_t cycles_startup;     // CPU cycles, ADC_Calibration_Cycles()
+	uint32_t calfact;            // CALFACT_S in use
+	uint32_t reference;          // Expected code: VREFINT_CAL (channel 0) or 0 (grounded input)
+	float    offset_none;        // Mean - reference in LSB, CALFACT_S = 0
+	float    offset_calibrated;  // Mean - reference in LSB, with the CALFACT of ADC_Init()
+} Benchmark_Calibration_Result;
+
+void Benchmark_Init(void);
+void Benchmark_Oversampling(Benchmark_Oversampling_Result *result);
+void Benchmark_Ring(Benchmark_Ring_Result *result);
+void Benchmark_Millivolts(Benchmark_Millivolts_Result *result);
+void Benchmark_Decimator(Benchmark_Decimator_Result *result);
+void Benchmark_Stats(Benchmark_Stats_Result *result);
+void Benchmark_FFT(Benchmark_FFT_Result *result);
+void Benchmark_Throughput(Benchmark_Throughput_Result results[BENCHMARK_CONFIGURATIONS]);
+void Benchmark_Codec(Benchmark_Codec_Result results[BENCHMARK_WAVEFORMS]);
+void Benchmark_Calibration(uint32_t channel, Benchmark_Calibration_Result *result);
+
+#endif /* __STM32L476G_DISCOVERY_BENCHMARK_H */
+
@@ -0,0 +1,155 @@
+#include "Codec.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Block Codec
+//  Lossless compression of ADC sample blocks for export (UART, USB, SD), where bandwidth is
+//  the bottleneck. Every block is self-contained, so a lost block does not corrupt the next
+//  one, and no memory is allocated: the caller provides both buffers.
+//  Format (little endian, bits packed LSB first):
+//    uint16  sample count n
+//    uint16  first sample
+//    then the n - 1 deltas in groups of CODEC_GROUP:
+//      5 bits  width w of the group (0..16)
+//      w bits  per delta, zig-zag coded: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+//    padded with zero bits to a whole byte
+//  Deltas are taken modulo 2^16, so any uint16_t input round-trips and a width never
+//  exceeds 16 bits. A slowly varying 12-bit signal needs a few bits per sample instead of 16.
+//  Codec_Decode() is the host-side decoder as well: compile Codec.c with any C compiler.
+// ******************************************************************************************
+
+// Number of significant bits of a 16-bit value (0..16)
+static uint32_t Codec_Width(uint32_t value){
+	uint32_t width;
+	
+	width = 0;
+	if (value >= 0x100) { width  = 8; value >>= 8; }
+	if (value >= 0x10)  { width += 4; value >>= 4; }
+	if (value >= 0x4)   { width += 2; value >>= 2; }
+	if (value >= 0x2)   { width += 1; value >>= 1; }
+	return width + value;
+}
+
+// ******************************************************************************************
+// Encode length samples into out (capacity bytes, CODEC_MAX_BYTES(length) always fits).
+// Returns the number of bytes written, 0 if out is too small or length is out of range.
+// ******************************************************************************************
+uint32_t Codec_Encode(const uint16_t *samples, uint32_t length, uint8_t *out, uint32_t capacity){
+	uint32_t zigzag[CODEC_GROUP];
+	uint32_t i, k, n, delta, used, width, acc, bits, previous;
+	uint8_t *p, *end;
+	
+	if (length == 0 || length > CODEC_MAX_SAMPLES || capacity < CODEC_HEADER)
+		return 0;
+	
+	out[0] = (uint8_t) length;
+	out[1] = (uint8_t) (length >> 8);
+	out[2] = (uint8_t) samples[0];
+	out[3] = (uint8_t) (samples[0] >> 8);
+	p = out + CODEC_HEADER;
+	end = out + capacity;
+	
+	acc = 0;
+	bits = 0;
+	previous = samples[0];
+	for (i = 1; i < length; i += n) {
+		n = length - i;
+		if (n > CODEC_GROUP)
+			n = CODEC_GROUP;
+		
+		// Zig-zag deltas of the group and their common width
+		used = 0;
+		for (k = 0; k < n; k++) {
+			delta = (samples[i + k] - previous) & 0xFFFF;
+			previous = samples[i + k];
+			zigzag[k] = ((delta << 1) ^ (0 - (delta >> 15))) & 0xFFFF;
+			used |= zigzag[k];
+		}
+		width = Codec_Width(used);
+		
+		// At most 7 bits are pending, so 7 + 16 bits always fit in the accumulator
+		acc |= width << bits;
+		bits += CODEC_WIDTH_BITS;
+		for (k = 0; k <= n; k++) {
+			while (bits >= 8) {
+				if (p == end)
+					return 0;
+				*p++ = (uint8_t) acc;
+				acc >>= 8;
+				bits -= 8;
+			}
+			if (k < n) {
+				acc |= zigzag[k] << bits;
+				bits += width;
+			}
+		}
+	}
+	
+	if (bits != 0) {
+		if (p == end)
+			return 0;
+		*p++ = (uint8_t) acc;
+	}
+	return (uint32_t) (p - out);
+}
+
+// ******************************************************************************************
+// Decode one block from in (size bytes available) into samples (capacity samples).
+// Returns the number of bytes consumed, i.e. the offset of the next block in a stream, and
+// the number of samples in *length. Returns 0 if the block is truncated or corrupt, or if
+// it holds more than capacity samples.
+// ******************************************************************************************
+uint32_t Codec_Decode(const uint8_t *in, uint32_t size, uint16_t *samples, uint32_t capacity, uint32_t *length){
+	uint32_t i, k, n, count, width, mask, acc, bits, zigzag, previous;
+	const uint8_t *p, *end;
+	
+	*length = 0;
+	if (size < CODEC_HEADER)
+		return 0;
+	
+	count = in[0] | ((uint32_t) in[1] << 8);
+	if (count == 0 || count > capacity)
+		return 0;
+	previous = in[2] | ((uint32_t) in[3] << 8);
+	samples[0] = (uint16_t) previous;
+	p = in + CODEC_HEADER;
+	end = in + size;
+	
+	acc = 0;
+	bits = 0;
+	for (i = 1; i < count; i += n) {
+		n = count - i;
+		if (n > CODEC_GROUP)
+			n = CODEC_GROUP;
+		
+		while (bits < CODEC_WIDTH_BITS) {
+			if (p == end)
+				return 0;
+			acc |= (uint32_t) *p++ << bits;
+			bits += 8;
+		}
+		width = acc & ((1U << CODEC_WIDTH_BITS) - 1);
+		acc >>= CODEC_WIDTH_BITS;
+		bits -= CODEC_WIDTH_BITS;
+		if (width > 16)
+			return 0;
+		mask = (1U << width) - 1;
+		
+		for (k = 0; k < n; k++) {
+			while (bits < width) {
+				if (p == end)
+					return 0;
+				acc |= (uint32_t) *p++ << bits;
+				bits += 8;
+			}
+			zigzag = acc & mask;
+			acc >>= width;
+			bits -= width;
+			previous = (previous + ((zigzag >> 1) ^ (0 - (zigzag & 1)))) & 0xFFFF;
+			samples[i + k] = (uint16_t) previous;
+		}
+	}
+	
+	*length = count;
+	return (uint32_t) (p - in);
+}
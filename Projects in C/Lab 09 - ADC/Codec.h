@@ -0,0 +1,18 @@
+#ifndef __STM32L476G_DISCOVERY_CODEC_H
+#define __STM32L476G_DISCOVERY_CODEC_H
+
+// Plain C, no device header: Codec.c also builds on the host to decode exported blocks
+#include <stdint.h>
+
+#define  CODEC_GROUP          16      // Deltas sharing one bit width
+#define  CODEC_WIDTH_BITS     5       // Bit width field, 0..16
+#define  CODEC_HEADER         4       // Sample count and first sample, 16-bit little endian
+#define  CODEC_MAX_SAMPLES    65535U
+
+// Largest encoded size of a block of n samples in bytes (every delta 16 bits wide)
+#define  CODEC_MAX_BYTES(n)   (CODEC_HEADER + (((n) / CODEC_GROUP + 1) * CODEC_WIDTH_BITS + 16 * (n) + 7) / 8)
+
+uint32_t Codec_Encode(const uint16_t *samples, uint32_t length, uint8_t *out, uint32_t capacity);
+uint32_t Codec_Decode(const uint8_t *in, uint32_t size, uint16_t *samples, uint32_t capacity, uint32_t *length);
+
+#endif /* __STM32L476G_DISCOVERY_CODEC_H */
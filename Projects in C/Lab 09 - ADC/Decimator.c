@@ -0,0 +1,132 @@
+#include "Decimator.h"
+#include "Intrinsics.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Decimation Pipeline
+//  12-bit ADC samples -> N-stage CIC decimating by R -> compensating FIR decimating by D.
+//  Overall output rate = sample rate / (R * D).
+//
+//  CIC: N integrators at the input rate, N combs (differential delay 1) at the output rate.
+//  The gain is R^N, i.e. N * log2(R) bits of growth. The registers are uint32_t and wrap
+//  around modulo 2^32 (well defined, unlike signed overflow); the combs undo the wrap as long
+//  as 12 + N * log2(R) <= 32 bits. The comb output is converted back to signed at the end.
+//  The CIC output is shifted to 16 bits: full scale of the ADC (0 .. 4095, centred on 2048)
+//  maps to -32768 .. 32767 (one ADC LSB = 16).
+//
+//  FIR: Q15 coefficients, taps[0] applies to the oldest sample. The sum of |taps| must stay
+//  below 2.0 (65536) so that the 32-bit accumulator cannot overflow. The FIR is computed only
+//  for the outputs that are kept (every D-th CIC output). The delay line is stored twice so
+//  that the taps always see one contiguous window.
+//
+//  Decimator_Process() works on a whole block (e.g. one DMA half-buffer) with no function call
+//  per sample. The state carries over between blocks, so the block length does not need to be
+//  a multiple of R * D.
+//  Plain C apart from CLZ and SSAT (Intrinsics.h); Tests/test_decimator.c checks it on the host.
+// ******************************************************************************************
+const int16_t Decimator_CIC4_R16_FIR[DECIMATOR_CIC4_R16_TAPS] = {
+	   88,    18,  -373,  -286,   863,  1195, -1337, -3542,   828, 10801, 16258,
+	10801,   828, -3542, -1337,  1195,   863,  -286,  -373,    18,    88
+};
+
+// Returns 1 when the configuration is valid, 0 otherwise (dec is left unchanged)
+uint32_t Decimator_Init(Decimator *dec, uint32_t stages, uint32_t ratio, const int16_t *taps, uint32_t taps_count, uint32_t fir_ratio){
+	uint32_t log2_ratio;
+	
+	if (stages == 0 || stages > DECIMATOR_MAX_STAGES)
+		return 0;
+	if (ratio < 2 || (ratio & (ratio - 1)) != 0)
+		return 0;
+	if (taps == 0 || taps_count == 0 || taps_count > DECIMATOR_MAX_TAPS || fir_ratio == 0)
+		return 0;
+	
+	log2_ratio = 31 - INTRINSIC_CLZ(ratio);
+	if (stages * log2_ratio < 4 || 12 + stages * log2_ratio > 32)
+		return 0;
+	
+	dec->stages = stages;
+	dec->ratio = ratio;
+	dec->shift = stages * log2_ratio - 4;
+	dec->taps = taps;
+	dec->taps_count = taps_count;
+	dec->fir_ratio = fir_ratio;
+	Decimator_Reset(dec);
+	return 1;
+}
+
+void Decimator_Reset(Decimator *dec){
+	uint32_t i;
+	
+	for (i = 0; i < DECIMATOR_MAX_STAGES; i++) {
+		dec->integrator[i] = 0;
+		dec->comb[i] = 0;
+	}
+	for (i = 0; i < 2 * DECIMATOR_MAX_TAPS; i++)
+		dec->history[i] = 0;
+	dec->phase = 0;
+	dec->fir_phase = 0;
+	dec->index = 0;
+}
+
+// Returns the number of samples written to output,
+// at most (length + R * D - 1) / (R * D)
+uint32_t Decimator_Process(Decimator *dec, const uint16_t *samples, uint32_t length, int16_t *output){
+	uint32_t integrator[DECIMATOR_MAX_STAGES];
+	uint32_t x, y;
+	int32_t cic, acc;
+	uint32_t i, s, k, n, stages, count;
+	const int16_t *taps, *window;
+	
+	stages = dec->stages;
+	count = dec->taps_count;
+	taps = dec->taps;
+	for (s = 0; s < stages; s++)
+		integrator[s] = dec->integrator[s];
+	
+	n = 0;
+	for (i = 0; i < length; i++) {
+		// Integrators, at the input rate
+		x = (uint32_t) samples[i] - DECIMATOR_MIDSCALE;
+		for (s = 0; s < stages; s++) {
+			x += integrator[s];
+			integrator[s] = x;
+		}
+		
+		if (++dec->phase < dec->ratio)
+			continue;
+		dec->phase = 0;
+		
+		// Combs, at the CIC output rate
+		for (s = 0; s < stages; s++) {
+			y = x - dec->comb[s];
+			dec->comb[s] = x;
+			x = y;
+		}
+		
+		// Back to two's complement without an implementation-defined conversion
+		cic = (x < 0x80000000U) ? (int32_t) x : -(int32_t) ~x - 1;
+		cic = INTRINSIC_SSAT16(cic >> dec->shift);
+		
+		// FIR delay line: newest sample at index + count - 1 (and its copy at index - 1)
+		dec->history[dec->index] = (int16_t) cic;
+		dec->history[dec->index + count] = (int16_t) cic;
+		if (++dec->index >= count)
+			dec->index = 0;
+		
+		if (++dec->fir_phase < dec->fir_ratio)
+			continue;
+		dec->fir_phase = 0;
+		
+		// FIR, only for the kept outputs
+		window = &dec->history[dec->index];
+		acc = 0;
+		for (k = 0; k < count; k++)
+			acc += (int32_t) taps[k] * window[k];
+		acc = (acc + 0x4000) >> 15;
+		output[n++] = (int16_t) INTRINSIC_SSAT16(acc);
+	}
+	
+	for (s = 0; s < stages; s++)
+		dec->integrator[s] = integrator[s];
+	return n;
+}
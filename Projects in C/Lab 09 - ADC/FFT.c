@@ -0,0 +1,236 @@
+#include "FFT.h"
+#include "Intrinsics.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Fixed-Point FFT
+//  In-place radix-4 decimation-in-frequency FFT on FFT_SIZE complex Q15 values, stored as
+//  interleaved pairs (re, im) in int16_t data[2 * FFT_SIZE] (4 KB for 1024 points).
+//  Each of the FFT_STAGES stages divides by 4, so the output is X[k] / FFT_SIZE and never
+//  overflows. The outputs come out in base-4 digit-reversed order and are put back into
+//  natural order at the end.
+//  Every stage does the same number of butterflies (FFT_SIZE / 4) and no data-dependent
+//  branches, so the cycle count is fixed (see Benchmark_FFT).
+//  Plain C apart from SSAT (Intrinsics.h); Tests/test_fft.c compares it with a double DFT.
+// ******************************************************************************************
+
+// sin(2 * pi * i / FFT_SIZE) in Q15, i = 0 .. FFT_SIZE / 4, computed by the compiler:
+// round(32768 sin(x)) saturated to 32767, the sine from its Taylor series on the quarter
+// wave (error below 1e-9, as DDS_SIN in Lab 10). FFT_QUARTER(M) expands M(i) for every
+// entry of the table for the FFT_SIZE of FFT.h.
+#if (1L << (2 * FFT_STAGES)) != FFT_SIZE
+#error "FFT_SIZE must be 4^FFT_STAGES"
+#endif
+
+#define  FFT_SIN(x)           ((x) * (1 - (x) * (x) / 6 * (1 - (x) * (x) / 20 * (1 - (x) * (x) / 42 * \
+                              (1 - (x) * (x) / 72 * (1 - (x) * (x) / 110 * (1 - (x) * (x) / 156)))))))
+#define  FFT_ROUND(v)         ((v) + 0.5 > 32767 ? 32767 : (int32_t) ((v) + 0.5))
+#define  FFT_SINE(i)          (int16_t) FFT_ROUND(32768 * FFT_SIN((i) * (6.28318530717958648 / FFT_SIZE))),
+
+#define  FFT_REPEAT4(M, i)    M(i) M((i) + 1) M((i) + 2) M((i) + 3)
+#define  FFT_REPEAT16(M, i)   FFT_REPEAT4(M, i) FFT_REPEAT4(M, (i) + 4) FFT_REPEAT4(M, (i) + 8) FFT_REPEAT4(M, (i) + 12)
+#define  FFT_REPEAT64(M, i)   FFT_REPEAT16(M, i) FFT_REPEAT16(M, (i) + 16) FFT_REPEAT16(M, (i) + 32) FFT_REPEAT16(M, (i) + 48)
+#define  FFT_REPEAT256(M, i)  FFT_REPEAT64(M, i) FFT_REPEAT64(M, (i) + 64) FFT_REPEAT64(M, (i) + 128) FFT_REPEAT64(M, (i) + 192)
+#define  FFT_REPEAT1024(M, i) FFT_REPEAT256(M, i) FFT_REPEAT256(M, (i) + 256) FFT_REPEAT256(M, (i) + 512) FFT_REPEAT256(M, (i) + 768)
+
+#if FFT_SIZE == 16
+#define  FFT_QUARTER(M)       FFT_REPEAT4(M, 0) M(4)
+#elif FFT_SIZE == 64
+#define  FFT_QUARTER(M)       FFT_REPEAT16(M, 0) M(16)
+#elif FFT_SIZE == 256
+#define  FFT_QUARTER(M)       FFT_REPEAT64(M, 0) M(64)
+#elif FFT_SIZE == 1024
+#define  FFT_QUARTER(M)       FFT_REPEAT256(M, 0) M(256)
+#elif FFT_SIZE == 4096
+#define  FFT_QUARTER(M)       FFT_REPEAT1024(M, 0) M(1024)
+#else
+#error "FFT_SIZE: no sine table for this size (16 .. 4096)"
+#endif
+
+static const int16_t FFT_Sine[FFT_SIZE / 4 + 1] = { FFT_QUARTER(FFT_SINE) };
+
+static int16_t FFT_Data[2 * FFT_SIZE];
+
+// sin(2 * pi * m / FFT_SIZE), m = 0 .. FFT_SIZE - 1, from the quarter-wave table
+static int32_t FFT_Sin(uint32_t m){
+	if (m <= FFT_SIZE / 4)
+		return FFT_Sine[m];
+	if (m <= FFT_SIZE / 2)
+		return FFT_Sine[FFT_SIZE / 2 - m];
+	if (m <= 3 * FFT_SIZE / 4)
+		return -FFT_Sine[m - FFT_SIZE / 2];
+	return -FFT_Sine[FFT_SIZE - m];
+}
+
+static int32_t FFT_Cos(uint32_t m){
+	return FFT_Sin((m + FFT_SIZE / 4) & (FFT_SIZE - 1));
+}
+
+// Integer square root, rounded down
+static uint32_t FFT_Sqrt(uint32_t value){
+	uint32_t root, bit;
+	
+	root = 0;
+	bit = 1U << 30;
+	while (bit > value)
+		bit >>= 2;
+	
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+// ******************************************************************************************
+// Radix-4 butterfly, inputs a, b, c, d spaced by L / 4 (all divided by 4 first)
+//   y0 = a + b + c + d
+//   y1 = (a - jb - c + jd) * W^n
+//   y2 = (a - b + c - d)   * W^2n
+//   y3 = (a + jb - c - jd) * W^3n        W = exp(-2 * pi * j / L)
+// The twiddle W^(qn) is read from the table at index q * n * (FFT_SIZE / L).
+// Input limit: |re + j im| <= 32767 for every point. A butterfly output is at most the mean
+// of its four inputs in magnitude, so then every stage stays within 16 bits. FFT_Window()
+// always meets it (im = 0). Beyond it, e.g. 32767 + j32767, a rotated output reaches
+// sqrt(2) * 32768; every output is therefore saturated to 16 bits (clips, never wraps).
+// The products stay below 2^31.
+// ******************************************************************************************
+void FFT_Q15(int16_t *data){
+	uint32_t L, quarter, step, group, n, i0, i1, i2, i3, m, i, r, k, d;
+	int32_t ar, ai, br, bi, cr, ci, dr, di;
+	int32_t t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i;
+	int32_t yr, yi, wc, ws, re, im;
+	int16_t swap;
+	
+	for (L = FFT_SIZE, step = 1; L >= 4; L >>= 2, step <<= 2) {
+		quarter = L >> 2;
+		for (n = 0; n < quarter; n++) {
+			for (group = 0; group < FFT_SIZE; group += L) {
+				i0 = 2 * (group + n);
+				i1 = i0 + 2 * quarter;
+				i2 = i1 + 2 * quarter;
+				i3 = i2 + 2 * quarter;
+				
+				// Divide by 4 with rounding
+				ar = (data[i0] + 2) >> 2;  ai = (data[i0 + 1] + 2) >> 2;
+				br = (data[i1] + 2) >> 2;  bi = (data[i1 + 1] + 2) >> 2;
+				cr = (data[i2] + 2) >> 2;  ci = (data[i2 + 1] + 2) >> 2;
+				dr = (data[i3] + 2) >> 2;  di = (data[i3 + 1] + 2) >> 2;
+				
+				t0r = ar + cr;  t0i = ai + ci;
+				t1r = ar - cr;  t1i = ai - ci;
+				t2r = br + dr;  t2i = bi + di;
+				t3r = br - dr;  t3i = bi - di;
+				
+				// y0 = t0 + t2, 4 x 8192 = 32768 saturates
+				data[i0]     = (int16_t) INTRINSIC_SSAT16(t0r + t2r);
+				data[i0 + 1] = (int16_t) INTRINSIC_SSAT16(t0i + t2i);
+				
+				// (yr + j yi) * (cos - j sin), rounded Q15
+				// y1 = t1 - j t3
+				m = n * step;
+				yr = t1r + t3i;  yi = t1i - t3r;
+				wc = FFT_Cos(m); ws = FFT_Sin(m);
+				re = (yr * wc + yi * ws + 0x4000) >> 15;
+				im = (yi * wc - yr * ws + 0x4000) >> 15;
+				data[i1]     = (int16_t) INTRINSIC_SSAT16(re);
+				data[i1 + 1] = (int16_t) INTRINSIC_SSAT16(im);
+				
+				// y2 = t0 - t2
+				yr = t0r - t2r;  yi = t0i - t2i;
+				wc = FFT_Cos(2 * m); ws = FFT_Sin(2 * m);
+				re = (yr * wc + yi * ws + 0x4000) >> 15;
+				im = (yi * wc - yr * ws + 0x4000) >> 15;
+				data[i2]     = (int16_t) INTRINSIC_SSAT16(re);
+				data[i2 + 1] = (int16_t) INTRINSIC_SSAT16(im);
+				
+				// y3 = t1 + j t3
+				yr = t1r - t3i;  yi = t1i + t3r;
+				wc = FFT_Cos(3 * m); ws = FFT_Sin(3 * m);
+				re = (yr * wc + yi * ws + 0x4000) >> 15;
+				im = (yi * wc - yr * ws + 0x4000) >> 15;
+				data[i3]     = (int16_t) INTRINSIC_SSAT16(re);
+				data[i3 + 1] = (int16_t) INTRINSIC_SSAT16(im);
+			}
+		}
+	}
+	
+	// Base-4 digit reversal
+	for (i = 0; i < FFT_SIZE; i++) {
+		r = 0;
+		k = i;
+		for (d = 0; d < FFT_STAGES; d++) {
+			r = (r << 2) | (k & 3U);
+			k >>= 2;
+		}
+		if (r > i) {
+			swap = data[2 * i];     data[2 * i]     = data[2 * r];     data[2 * r]     = swap;
+			swap = data[2 * i + 1]; data[2 * i + 1] = data[2 * r + 1]; data[2 * r + 1] = swap;
+		}
+	}
+}
+
+// ******************************************************************************************
+// Window
+//  12-bit samples -> mean removed -> Q15 (x 16) -> Hann window -> complex with im = 0.
+//  Hann: w[i] = (1 - cos(2 * pi * i / FFT_SIZE)) / 2, from the same sine table.
+// ******************************************************************************************
+void FFT_Window(const uint16_t *samples, int16_t *data){
+	uint32_t i, sum;
+	int32_t mean, x, w;
+	
+	sum = 0;
+	for (i = 0; i < FFT_SIZE; i++)
+		sum += samples[i];
+	mean = (int32_t) ((sum + FFT_SIZE / 2) / FFT_SIZE);
+	
+	for (i = 0; i < FFT_SIZE; i++) {
+		x = ((int32_t) samples[i] - mean) << 4;
+		if (x > 32767) x = 32767;
+		if (x < -32768) x = -32768;
+		w = (32768 - FFT_Cos(i)) >> 1;              // Q15
+		data[2 * i]     = (int16_t) ((x * w + 0x4000) >> 15);
+		data[2 * i + 1] = 0;
+	}
+}
+
+// |X[k]| for k = 0 .. FFT_BINS - 1, in the output scale of FFT_Q15 (X[k] / FFT_SIZE)
+void FFT_Magnitude(const int16_t *data, uint16_t *magnitude){
+	uint32_t k;
+	int32_t re, im;
+	
+	for (k = 0; k < FFT_BINS; k++) {
+		re = data[2 * k];
+		im = data[2 * k + 1];
+		magnitude[k] = (uint16_t) FFT_Sqrt((uint32_t) (re * re) + (uint32_t) (im * im));
+	}
+}
+
+// Largest bin above DC
+void FFT_Dominant(const uint16_t *magnitude, uint32_t sample_rate, FFT_Peak *peak){
+	uint32_t k;
+	
+	peak->bin = 1;
+	for (k = 2; k < FFT_BINS; k++)
+		if (magnitude[k] > magnitude[peak->bin])
+			peak->bin = k;
+	peak->magnitude = magnitude[peak->bin];
+	peak->frequency = (peak->bin * sample_rate + FFT_SIZE / 2) / FFT_SIZE;
+}
+
+// ******************************************************************************************
+// Spectrum of FFT_SIZE samples taken at sample_rate (Hz): window, FFT, FFT_BINS magnitudes
+// and the dominant component. Bin k is at k * sample_rate / FFT_SIZE Hz.
+// Uses a static 4 KB work buffer, so it must not be called from two contexts at once.
+// ******************************************************************************************
+void FFT_Spectrum(const uint16_t *samples, uint32_t sample_rate, uint16_t *magnitude, FFT_Peak *peak){
+	FFT_Window(samples, FFT_Data);
+	FFT_Q15(FFT_Data);
+	FFT_Magnitude(FFT_Data, magnitude);
+	FFT_Dominant(magnitude, sample_rate, peak);
+}
@@ -0,0 +1,24 @@
+#ifndef __STM32L476G_DISCOVERY_FFT_H
+#define __STM32L476G_DISCOVERY_FFT_H
+
+// Plain C, no device header: also built and tested on the host (Tests/)
+#include <stdint.h>
+
+#define  FFT_SIZE         1024    // Points, a power of 4
+#define  FFT_STAGES       5       // log4(FFT_SIZE)
+#define  FFT_BINS         (FFT_SIZE / 2)
+
+// Dominant component of a spectrum
+typedef struct {
+	uint32_t bin;          // 1 .. FFT_BINS - 1 (DC excluded)
+	uint32_t frequency;    // Hz, bin * sample_rate / FFT_SIZE
+	uint16_t magnitude;    // Same scale as FFT_Magnitude()
+} FFT_Peak;
+
+void FFT_Q15(int16_t *data);
+void FFT_Window(const uint16_t *samples, int16_t *data);
+void FFT_Magnitude(const int16_t *data, uint16_t *magnitude);
+void FFT_Dominant(const uint16_t *magnitude, uint32_t sample_rate, FFT_Peak *peak);
+void FFT_Spectrum(const uint16_t *samples, uint32_t sample_rate, uint16_t *magnitude, FFT_Peak *peak);
+
+#endif /* __STM32L476G_DISCOVERY_FFT_H */
@@ -0,0 +1,34 @@
+#ifndef __STM32L476G_DISCOVERY_INTRINSICS_H
+#define __STM32L476G_DISCOVERY_INTRINSICS_H
+
+#include <stdint.h>
+
+// ******************************************************************************************
+// Portable Intrinsics
+//  On the target (a Cortex-M: __ARM_ARCH_PROFILE is 'M') these are the CMSIS intrinsics.
+//  On the host (Tests/Makefile) they are plain C with the same results, so that the modules
+//  built on them (Ring, Decimator, FFT, StatsDSP) compile and run off the board.
+//  The host versions may evaluate their argument more than once.
+// ******************************************************************************************
+#if defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+
+#include "stm32l476xx.h"
+
+#define  INTRINSIC_CLZ(x)       __CLZ(x)               // Leading zeros, 32 for x = 0
+#define  INTRINSIC_SSAT16(x)    __SSAT((x), 16)        // Saturate to -32768 .. 32767
+#define  INTRINSIC_DMB()        __DMB()                // Data memory barrier
+
+#else
+
+#define  INTRINSIC_CLZ(x)       ((x) == 0 ? 32U : (uint32_t) __builtin_clz(x))
+#define  INTRINSIC_SSAT16(x)    ((x) > 32767 ? 32767 : ((x) < -32768 ? -32768 : (x)))
+#define  INTRINSIC_DMB()        __sync_synchronize()
+
+// Host test of the SIMD code: the test defines __ARM_FEATURE_DSP and emulates the instructions
+#if defined(__ARM_FEATURE_DSP)
+#include "DSP_Host.h"
+#endif
+
+#endif
+
+#endif /* __STM32L476G_DISCOVERY_INTRINSICS_H */
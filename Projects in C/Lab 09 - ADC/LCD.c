@@ -199,24 +199,28 @@ void LCD_Clock_Init(void){
 		while((PWR->CR1 & PWR_CR1_DBP) == 0);  	// Wait for Backup domain Write protection disable
 	}
 	
-	// Reset LSEON and LSEBYP bits before configuring the LSE
-	RCC->BDCR &= ~(RCC_BDCR_LSEON | RCC_BDCR_LSEBYP);
-
-	// RTC Clock selection can be changed only if the Backup Domain is reset
-	RCC->BDCR |=  RCC_BDCR_BDRST;
-	RCC->BDCR &= ~RCC_BDCR_BDRST;
-	
-	// Note from STM32L4 Reference Manual: 	
-  // RTC/LCD Clock:  (1) LSE is in the Backup domain. (2) HSE and LSI are not.	
-	while((RCC->BDCR & RCC_BDCR_LSERDY) == 0){  // Wait until LSE clock ready
-		RCC->BDCR |= RCC_BDCR_LSEON;
+	// The Backup Domain survives a warm reset: keep it (and the RTC backup registers, which
+	// hold the cached ADC calibration) when LSE is already running as RTC clock
+	if ((RCC->BDCR & RCC_BDCR_LSERDY) == 0 || (RCC->BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_0) {
+		// Reset LSEON and LSEBYP bits before configuring the LSE
+		RCC->BDCR &= ~(RCC_BDCR_LSEON | RCC_BDCR_LSEBYP);
+
+		// RTC Clock selection can be changed only if the Backup Domain is reset
+		RCC->BDCR |=  RCC_BDCR_BDRST;
+		RCC->BDCR &= ~RCC_BDCR_BDRST;
+		
+		// Note from STM32L4 Reference Manual: 	
+		// RTC/LCD Clock:  (1) LSE is in the Backup domain. (2) HSE and LSI are not.	
+		while((RCC->BDCR & RCC_BDCR_LSERDY) == 0){  // Wait until LSE clock ready
+			RCC->BDCR |= RCC_BDCR_LSEON;
+		}
+		
+		// Select LSE as RTC clock source
+		// BDCR = Backup Domain Control Register 
+		RCC->BDCR	&= ~RCC_BDCR_RTCSEL;	  // RTCSEL[1:0]: 00 = No Clock, 01 = LSE, 10 = LSI, 11 = HSE
+		RCC->BDCR	|= RCC_BDCR_RTCSEL_0;   // Select LSE as RTC clock	
 	}
 	
-	// Select LSE as RTC clock source
-	// BDCR = Backup Domain Control Register 
-	RCC->BDCR	&= ~RCC_BDCR_RTCSEL;	  // RTCSEL[1:0]: 00 = No Clock, 01 = LSE, 10 = LSI, 11 = HSE
-	RCC->BDCR	|= RCC_BDCR_RTCSEL_0;   // Select LSE as RTC clock	
-	
 	RCC->APB1ENR1 &= ~RCC_APB1ENR1_PWREN;	// Power interface clock disable
 	
 	// Wait for the external capacitor Cext which is connected to the VLCD pin is charged (approximately 2ms for Cext=1uF) 
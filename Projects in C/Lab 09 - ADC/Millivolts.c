@@ -0,0 +1,52 @@
+#include "Millivolts.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Conversion to millivolts
+//  VDDA = MILLIVOLTS_CAL_VREF * VREFINT_CAL / VREFINT_DATA, rounded to 1 mV.
+//  mV = DATA * VDDA / full_scale, computed as (DATA * scale + 0.5) >> 16 with scale in Q16;
+//  full_scale is the largest code, 4095 at 12 bits, 1023, 255 or 63 at 10, 8 or 6 bits.
+//  DATA * scale < 2^28 for VDDA <= 3.6 V, so one 32-bit multiply-accumulate per sample and no
+//  division. The loop is unrolled by 4 (16-bit loads and stores, no function calls).
+//  Tests/test_millivolts.c bounds the error against a float reference.
+// ******************************************************************************************
+
+// VDDA in mV from the factory and the measured VREFINT codes, 0 if vrefint_data is 0
+uint32_t Millivolts_VDDA(uint32_t vrefint_cal, uint32_t vrefint_data){
+	if (vrefint_data == 0)
+		return 0;
+	return (MILLIVOLTS_CAL_VREF * vrefint_cal + vrefint_data / 2) / vrefint_data;
+}
+
+// Q16 millivolts per LSB at VDDA (mV), for codes 0 .. full_scale
+uint32_t Millivolts_Scale(uint32_t vdda, uint32_t full_scale){
+	return ((vdda << 16) + full_scale / 2) / full_scale;
+}
+
+// samples and millivolts may be the same buffer. Within 0.53 mV of DATA * VDDA / 4095.
+void Millivolts_Convert(const uint16_t *samples, uint16_t *millivolts, uint32_t length, uint32_t scale){
+	uint32_t n;
+	uint32_t a, b, c, d;
+	
+	n = length >> 2;
+	while (n > 0) {
+		a = samples[0];
+		b = samples[1];
+		c = samples[2];
+		d = samples[3];
+		millivolts[0] = (uint16_t) ((a * scale + 0x8000U) >> 16);
+		millivolts[1] = (uint16_t) ((b * scale + 0x8000U) >> 16);
+		millivolts[2] = (uint16_t) ((c * scale + 0x8000U) >> 16);
+		millivolts[3] = (uint16_t) ((d * scale + 0x8000U) >> 16);
+		samples += 4;
+		millivolts += 4;
+		n--;
+	}
+	
+	n = length & 3U;
+	while (n > 0) {
+		a = *samples++;
+		*millivolts++ = (uint16_t) ((a * scale + 0x8000U) >> 16);
+		n--;
+	}
+}
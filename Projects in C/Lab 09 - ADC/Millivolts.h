@@ -0,0 +1,14 @@
+#ifndef __STM32L476G_DISCOVERY_MILLIVOLTS_H
+#define __STM32L476G_DISCOVERY_MILLIVOLTS_H
+
+// Plain C, no device header: the kernel is also built and tested on the host (Tests/)
+#include <stdint.h>
+
+#define  MILLIVOLTS_FULL_SCALE    4095U   // 12-bit, right aligned (10, 8, 6-bit: 1023, 255, 63)
+#define  MILLIVOLTS_CAL_VREF      3000U   // mV, VDDA when VREFINT_CAL was acquired
+
+uint32_t Millivolts_VDDA(uint32_t vrefint_cal, uint32_t vrefint_data);
+uint32_t Millivolts_Scale(uint32_t vdda, uint32_t full_scale);
+void Millivolts_Convert(const uint16_t *samples, uint16_t *millivolts, uint32_t length, uint32_t scale);
+
+#endif /* __STM32L476G_DISCOVERY_MILLIVOLTS_H */
@@ -0,0 +1,58 @@
+#include "Ring.h"
+#include "Intrinsics.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Single-Producer/Single-Consumer Sample Ring
+//  The head is written only by the producer (e.g. an ISR) and the tail only by the consumer
+//  (e.g. the main loop), so neither side ever waits for the other and no lock is needed.
+//  Head and tail are free-running counters: head - tail is the number of stored samples, also
+//  across the 2^32 wrap. The slot of counter c is c & (size - 1).
+//  Plain C apart from the memory barrier (Intrinsics.h), so it is unit-tested on the host
+//  (Tests/test_ring.c).
+// ******************************************************************************************
+
+// size must be a power of 2
+void Ring_Init(Ring *ring, uint16_t *buffer, uint32_t size){
+	ring->buffer = buffer;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->dropped = 0;
+}
+
+// Returns 1 when the sample is stored, 0 when the ring is full (the sample is dropped)
+uint32_t Ring_Push(Ring *ring, uint16_t sample){
+	uint32_t head = ring->head;
+	
+	if (head - ring->tail == ring->size) {
+		ring->dropped++;       // Full: drop the newest sample, never block the producer
+		return 0;
+	}
+	ring->buffer[head & (ring->size - 1)] = sample;
+	INTRINSIC_DMB();         // The sample must be visible before the new head
+	ring->head = head + 1;
+	return 1;
+}
+
+// Moves up to max samples, oldest first. Returns the number of samples moved.
+uint32_t Ring_Read(Ring *ring, uint16_t *samples, uint32_t max){
+	uint32_t tail, count, i;
+	
+	tail  = ring->tail;
+	count = ring->head - tail;
+	INTRINSIC_DMB();         // Read the head before the samples it covers
+	if (count > max)
+		count = max;
+	
+	for (i = 0; i < count; i++)
+		samples[i] = ring->buffer[(tail + i) & (ring->size - 1)];
+	
+	INTRINSIC_DMB();         // Finish reading before releasing the slots
+	ring->tail = tail + count;
+	return count;
+}
+
+uint32_t Ring_Count(const Ring *ring){
+	return ring->head - ring->tail;
+}
@@ -0,0 +1,20 @@
+#ifndef __STM32L476G_DISCOVERY_RING_H
+#define __STM32L476G_DISCOVERY_RING_H
+
+#include <stdint.h>
+
+// Single-producer/single-consumer ring of 16-bit samples
+typedef struct {
+	uint16_t *buffer;
+	uint32_t size;                 // Number of slots, a power of 2
+	volatile uint32_t head;        // Next slot to write, owned by the producer
+	volatile uint32_t tail;        // Next slot to read, owned by the consumer
+	volatile uint32_t dropped;     // Samples lost because the ring was full
+} Ring;
+
+void Ring_Init(Ring *ring, uint16_t *buffer, uint32_t size);
+uint32_t Ring_Push(Ring *ring, uint16_t sample);
+uint32_t Ring_Read(Ring *ring, uint16_t *samples, uint32_t max);
+uint32_t Ring_Count(const Ring *ring);
+
+#endif /* __STM32L476G_DISCOVERY_RING_H */
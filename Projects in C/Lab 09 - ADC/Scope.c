@@ -0,0 +1,297 @@
+#include "Scope.h"
+#include "ADC.h"
+#include "stm32l476xx.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Triggered Capture (scope mode)
+//  Works directly on the circular buffer of ADC_DMA_Start(). Scope_Process() is called from
+//  the half/full DMA callback with the block that has just been written and looks for the
+//  trigger on one rank of the scan sequence. The buffer itself holds the pre-trigger history.
+//  Once the post-trigger samples are in, the ADC and the DMA are stopped (ADC_DMA_Stop) and
+//  the capture stays frozen in the buffer: Scope_Poll() returns a snapshot that points into
+//  it, nothing is copied. Scope_Release() restarts the stream (ADC_DMA_Restart) and re-arms.
+//
+//  Positions are counted in buffer samples since the stream started (Scope_Delivered), so
+//  a trigger reported by the analog watchdog, which may lie in the block the DMA is still
+//  filling, is handled like a software trigger.
+//
+//  When the freeze happens the window ends in the block just delivered, and the DMA has
+//  already started to overwrite the other half. The window must therefore fit in half the
+//  buffer, minus the few samples (SCOPE_GUARD) written before ADC_DMA_Stop takes effect:
+//    (pre + post) * stride <= length / 2 - SCOPE_GUARD
+//  Call Scope_Process() first in the DMA callback to keep that latency short.
+//
+//  Longer windows: Scope_Init_Capture() adds a capture buffer of the caller. Every block
+//  delivered while armed has its samples of the channel copied there, the capture freezes
+//  in that buffer and the stream is never stopped. The window is then limited by the
+//  capture buffer only, which also holds the rest of the block that completes the window:
+//    pre + post + (length / 2) / stride <= capacity
+// ******************************************************************************************
+#define  SCOPE_IDLE        0U
+#define  SCOPE_ARMED       1U
+#define  SCOPE_TRIGGERED   2U
+#define  SCOPE_FROZEN      3U
+
+static Scope_Snapshot Scope_Capture;
+static uint32_t Scope_Length;            // Samples in the DMA buffer
+static uint32_t Scope_Stride;            // Scan length
+static uint32_t Scope_Rank;              // Rank of the channel in the scan sequence (0 = first)
+static uint32_t Scope_Pre, Scope_Post;
+static uint32_t Scope_Mode, Scope_Level;
+static uint32_t Scope_Watchdog;          // 0: software trigger
+static uint16_t Scope_Previous;          // Last sample of the channel, for the edge triggers
+static uint32_t Scope_Has_Previous;
+
+static uint16_t *Scope_Copy;             // Capture buffer, 0: capture in place in the DMA buffer
+static uint32_t Scope_Copy_Size;
+static uint32_t Scope_Copy_Index;        // Capture buffer index of the channel sample at Scope_Delivered
+static uint32_t Scope_Trigger_Copy;      // Capture buffer index of the trigger sample
+
+static ADC_AWD_Settings Scope_AWD_Saved; // Settings of the watchdog before Scope_Trigger_AWD()
+static uint32_t Scope_AWD_Owned;         // Watchdog taken over, 0: none
+
+static volatile uint32_t Scope_State;
+static uint32_t Scope_Delivered;         // Buffer samples delivered since the stream started
+static uint32_t Scope_Index;             // Buffer index of the next block (Scope_Delivered mod length)
+static uint32_t Scope_Armed_At;          // Scope_Delivered when armed
+static uint32_t Scope_AWD_Armed;
+static uint32_t Scope_Trigger_At;        // Position of the trigger sample (Scope_Delivered units)
+static uint32_t Scope_Trigger_Index;     // Buffer index of the trigger sample
+
+// Hands a watchdog taken over by Scope_Trigger_AWD() back to its previous owner
+static void Scope_AWD_Give_Back(void){
+	if (Scope_AWD_Owned != 0) {
+		ADC_AWD_Restore(Scope_AWD_Owned, &Scope_AWD_Saved);
+		Scope_AWD_Owned = 0;
+	}
+}
+
+static void Scope_Setup(const uint16_t *buffer, uint32_t length, uint32_t stride, uint32_t rank, uint32_t pre, uint32_t post){
+	Scope_AWD_Give_Back();
+	Scope_Capture.buffer = buffer;
+	Scope_Capture.length = length;
+	Scope_Capture.stride = stride;
+	Scope_Capture.count = pre + post;
+	Scope_Capture.trigger = pre;
+	Scope_Length = length;
+	Scope_Stride = stride;
+	Scope_Rank = rank;
+	Scope_Pre = pre;
+	Scope_Post = post;
+	Scope_Mode = SCOPE_TRIGGER_RISING;
+	Scope_Level = 2048;
+	Scope_Watchdog = 0;
+	Scope_Copy = 0;
+	Scope_Copy_Size = 0;
+	Scope_Copy_Index = 0;
+	Scope_State = SCOPE_IDLE;
+	Scope_Delivered = 0;
+	Scope_Index = 0;
+}
+
+// Capture in place in the DMA buffer. Returns 1 when the window fits, 0 otherwise
+uint32_t Scope_Init(const uint16_t *buffer, uint32_t length, uint32_t stride, uint32_t rank, uint32_t pre, uint32_t post){
+	if (stride == 0 || rank >= stride || post == 0 || (length / 2) % stride != 0)
+		return 0;
+	if (length < 2 * SCOPE_GUARD || (pre + post) * stride > length / 2 - SCOPE_GUARD)
+		return 0;
+	
+	Scope_Setup(buffer, length, stride, rank, pre, post);
+	return 1;
+}
+
+// Capture copied to capture[0 .. capacity - 1], the stream keeps running.
+// Returns 1 when the window fits, 0 otherwise
+uint32_t Scope_Init_Capture(const uint16_t *buffer, uint32_t length, uint32_t stride, uint32_t rank, uint32_t pre, uint32_t post,
+                            uint16_t *capture, uint32_t capacity){
+	if (stride == 0 || rank >= stride || post == 0 || length < 2 || (length / 2) % stride != 0 || capture == 0)
+		return 0;
+	if (pre + post + (length / 2) / stride > capacity)
+		return 0;
+	
+	Scope_Setup(buffer, length, stride, rank, pre, post);
+	Scope_Copy = capture;
+	Scope_Copy_Size = capacity;
+	Scope_Capture.buffer = capture;
+	Scope_Capture.length = capacity;
+	Scope_Capture.stride = 1;
+	return 1;
+}
+
+// Software trigger on the samples of the channel. A watchdog taken over by
+// Scope_Trigger_AWD() is handed back: call it while the stream is stopped (ADSTART=0)
+void Scope_Trigger(uint32_t mode, uint32_t level){
+	Scope_AWD_Give_Back();
+	Scope_Mode = mode;
+	Scope_Level = level;
+	Scope_Watchdog = 0;
+}
+
+// Hardware trigger: analog watchdog 1, 2 or 3 on channel (the channel of the scope rank).
+// The scope takes the watchdog over, callback included (e.g. PA1_Out_Of_Window of main.c
+// on AWD1). Its previous settings are saved and handed back by Scope_Trigger() or the next
+// Scope_Init(). Call it while the stream is stopped (ADSTART=0), like ADC_AWD_Config().
+static void Scope_AWD_Fired(uint32_t watchdog);
+
+void Scope_Trigger_AWD(uint32_t watchdog, uint32_t channel, uint32_t low, uint32_t high){
+	if (watchdog < 1 || watchdog > 3)
+		return;
+	if (Scope_AWD_Owned != watchdog) {
+		Scope_AWD_Give_Back();
+		ADC_AWD_Save(watchdog, &Scope_AWD_Saved);
+		Scope_AWD_Owned = watchdog;
+	}
+	Scope_Mode = SCOPE_TRIGGER_AWD;
+	Scope_Watchdog = watchdog;
+	ADC_AWD_Config(watchdog, channel, low, high, Scope_AWD_Fired);
+	ADC_AWD_Disarm(watchdog);             // Armed once the pre-trigger history is there
+}
+
+void Scope_Arm(void){
+	Scope_Has_Previous = 0;
+	Scope_AWD_Armed = 0;
+	Scope_Armed_At = Scope_Delivered;
+	Scope_State = SCOPE_ARMED;
+}
+
+static void Scope_Triggered(uint32_t at, uint32_t index){
+	uint32_t behind;
+	
+	Scope_Trigger_At = at;
+	Scope_Trigger_Index = index;
+	
+	// Capture buffer index: at - Scope_Delivered is rank + k * stride, k < 0 when the
+	// watchdog reports a sample that has already been delivered
+	if (Scope_Copy != 0) {
+		if ((int32_t) (at - Scope_Delivered) >= 0) {
+			Scope_Trigger_Copy = (Scope_Copy_Index + (at - Scope_Delivered) / Scope_Stride) % Scope_Copy_Size;
+		} else {
+			behind = ((Scope_Delivered - at + Scope_Stride - 1) / Scope_Stride) % Scope_Copy_Size;
+			Scope_Trigger_Copy = (Scope_Copy_Index + Scope_Copy_Size - behind) % Scope_Copy_Size;
+		}
+	}
+	Scope_State = SCOPE_TRIGGERED;
+}
+
+// Runs in ADC1_2_IRQHandler. The trigger is the last sample of the channel written by the DMA.
+static void Scope_AWD_Fired(uint32_t watchdog){
+	uint32_t length, stride, position, ahead, last, back;
+	
+	(void) watchdog;                      // Only Scope_Watchdog is configured with this callback
+	
+	if (Scope_State != SCOPE_ARMED)
+		return;
+	
+	length = Scope_Length;
+	stride = Scope_Stride;
+	position = ADC_DMA_Position();
+	ahead = (position + length - Scope_Index) % length;   // Written but not delivered yet
+	if (ahead == 0)
+		return;                           // Nothing of the channel written yet, keep waiting
+	
+	// Last buffer sample written, then back to the rank of the channel. The trigger sample is
+	// ahead - 1 - back samples after the delivered data (it may already have been delivered).
+	last = (position + length - 1) % length;
+	back = ((last % stride) + stride - Scope_Rank) % stride;
+	last = (last + length - back) % length;
+	Scope_Triggered(Scope_Delivered + ahead - 1 - back, last);
+}
+
+static void Scope_Freeze(void){
+	if (Scope_Copy != 0) {
+		Scope_Capture.start = (Scope_Trigger_Copy + Scope_Copy_Size - Scope_Pre % Scope_Copy_Size) % Scope_Copy_Size;
+	} else {
+		ADC_DMA_Stop();
+		Scope_Capture.start = (Scope_Trigger_Index + Scope_Length - (Scope_Pre * Scope_Stride) % Scope_Length) % Scope_Length;
+	}
+	Scope_State = SCOPE_FROZEN;
+}
+
+// Call from the DMA half/full callback with the block that is ready
+void Scope_Process(const uint16_t *samples, uint32_t length){
+	uint32_t i, n, x, stride, fire, needed;
+	
+	if (Scope_State == SCOPE_IDLE)
+		return;
+	
+	// In place the stream is stopped; a capture buffer keeps its snapshot while the
+	// stream goes on, only the position in the DMA buffer is followed
+	if (Scope_State == SCOPE_FROZEN) {
+		if (Scope_Copy != 0) {
+			Scope_Delivered += length;
+			Scope_Index = (Scope_Index + length) % Scope_Length;
+		}
+		return;
+	}
+	
+	stride = Scope_Stride;
+	
+	if (Scope_State == SCOPE_ARMED && Scope_Watchdog == 0) {
+		for (i = Scope_Rank; i < length; i += stride) {
+			x = samples[i];
+			// Only once the pre-trigger history is in the buffer
+			if ((Scope_Delivered + i) - Scope_Armed_At >= Scope_Pre * stride) {
+				switch (Scope_Mode) {
+					case SCOPE_TRIGGER_ABOVE:   fire = x >= Scope_Level; break;
+					case SCOPE_TRIGGER_BELOW:   fire = x <= Scope_Level; break;
+					case SCOPE_TRIGGER_RISING:  fire = Scope_Has_Previous && Scope_Previous < Scope_Level && x >= Scope_Level; break;
+					case SCOPE_TRIGGER_FALLING: fire = Scope_Has_Previous && Scope_Previous > Scope_Level && x <= Scope_Level; break;
+					default:                    fire = 0; break;
+				}
+				if (fire) {
+					Scope_Triggered(Scope_Delivered + i, (Scope_Index + i) % Scope_Length);
+					break;
+				}
+			}
+			Scope_Previous = (uint16_t) x;
+			Scope_Has_Previous = 1;
+		}
+	}
+	
+	// Samples of the channel to the capture buffer
+	if (Scope_Copy != 0) {
+		n = Scope_Copy_Index;
+		for (i = Scope_Rank; i < length; i += stride) {
+			Scope_Copy[n] = samples[i];
+			if (++n == Scope_Copy_Size)
+				n = 0;
+		}
+		Scope_Copy_Index = n;
+	}
+	
+	Scope_Delivered += length;
+	Scope_Index = (Scope_Index + length) % Scope_Length;
+	
+	// Analog watchdog: arm it once the pre-trigger history is in the buffer
+	if (Scope_State == SCOPE_ARMED && Scope_Watchdog != 0 && Scope_AWD_Armed == 0 &&
+	    Scope_Delivered - Scope_Armed_At >= Scope_Pre * stride) {
+		Scope_AWD_Armed = 1;
+		ADC_AWD_Arm(Scope_Watchdog);
+	}
+	
+	// Frozen as soon as the last post-trigger sample has been delivered
+	// (signed: a watchdog trigger may still be ahead of the delivered data)
+	needed = (Scope_Post - 1) * stride + 1;
+	if (Scope_State == SCOPE_TRIGGERED && (int32_t) (Scope_Delivered - Scope_Trigger_At) >= (int32_t) needed)
+		Scope_Freeze();
+}
+
+// Returns the capture once frozen, 0 otherwise. The snapshot stays valid until Scope_Release().
+const Scope_Snapshot *Scope_Poll(void){
+	if (Scope_State != SCOPE_FROZEN)
+		return 0;
+	return &Scope_Capture;
+}
+
+// Hands the buffer back to the DMA (in place) and waits for the next trigger
+void Scope_Release(void){
+	if (Scope_Copy != 0) {
+		Scope_Arm();
+		return;
+	}
+	Scope_Delivered = 0;
+	Scope_Index = 0;
+	Scope_Arm();
+	ADC_DMA_Restart();
+}
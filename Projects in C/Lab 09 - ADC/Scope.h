@@ -0,0 +1,38 @@
+#ifndef __STM32L476G_DISCOVERY_SCOPE_H
+#define __STM32L476G_DISCOVERY_SCOPE_H
+
+#include "stm32l476xx.h"
+
+#define  SCOPE_GUARD              16U    // Samples the DMA may write between the callback and the freeze
+
+// Trigger modes
+#define  SCOPE_TRIGGER_ABOVE      0U     // Level: first sample >= level
+#define  SCOPE_TRIGGER_BELOW      1U     // Level: first sample <= level
+#define  SCOPE_TRIGGER_RISING     2U     // Edge:  previous < level <= sample
+#define  SCOPE_TRIGGER_FALLING    3U     // Edge:  previous > level >= sample
+#define  SCOPE_TRIGGER_AWD        4U     // Analog watchdog: first conversion outside [low, high]
+
+// A frozen capture, in place in the DMA buffer or in the capture buffer of Scope_Init_Capture()
+typedef struct {
+	const uint16_t *buffer;   // DMA circular buffer, or capture buffer
+	uint32_t length;          // Samples in the buffer
+	uint32_t start;           // Buffer index of the oldest sample of the capture
+	uint32_t stride;          // Buffer distance between two samples of the channel (scan length, 1 in a capture buffer)
+	uint32_t count;           // Samples of the channel in the capture: pre + post
+	uint32_t trigger;         // Sample k = pre is the trigger sample
+} Scope_Snapshot;
+
+// Sample k (0 .. count - 1) of a snapshot
+#define  SCOPE_SAMPLE(s, k)       ((s)->buffer[((s)->start + (k) * (s)->stride) % (s)->length])
+
+uint32_t Scope_Init(const uint16_t *buffer, uint32_t length, uint32_t stride, uint32_t rank, uint32_t pre, uint32_t post);
+uint32_t Scope_Init_Capture(const uint16_t *buffer, uint32_t length, uint32_t stride, uint32_t rank, uint32_t pre, uint32_t post,
+                            uint16_t *capture, uint32_t capacity);
+void Scope_Trigger(uint32_t mode, uint32_t level);
+void Scope_Trigger_AWD(uint32_t watchdog, uint32_t channel, uint32_t low, uint32_t high);
+void Scope_Arm(void);
+void Scope_Process(const uint16_t *samples, uint32_t length);
+const Scope_Snapshot *Scope_Poll(void);
+void Scope_Release(void);
+
+#endif /* __STM32L476G_DISCOVERY_SCOPE_H */
@@ -0,0 +1,68 @@
+#include "Stats.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Block Statistics
+//  min, max, mean and RMS of a block of ADC samples, e.g. one de-interleaved DMA half-buffer.
+//  Samples must be below 0x8000 (12-bit results, or oversampled results up to 15 bits) and
+//  a block holds at most 65535 samples, so the sum fits in 31 bits.
+//
+//  Stats_Block_Portable() is the plain C version (this file, no device header). It is used
+//  when the DSP extension is not available (__ARM_FEATURE_DSP) and is the reference for
+//  Benchmark_Stats() and Tests/test_stats.c. Stats_Block() is the SIMD version (StatsDSP.c).
+// ******************************************************************************************
+
+// Integer square root of a 64-bit value, rounded down
+static uint32_t Stats_Sqrt(uint64_t value){
+	uint64_t root, bit;
+	
+	root = 0;
+	bit = (uint64_t) 1 << 62;
+	while (bit > value)
+		bit >>= 2;
+	
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t) root;
+}
+
+// mean and RMS from the sums, shared with StatsDSP.c
+void Stats_Finish(uint32_t length, uint32_t sum, uint64_t sumsq, Stats_Result *stats){
+	stats->length = length;
+	stats->mean = (uint16_t) ((sum + length / 2) / length);
+	stats->rms  = (uint16_t) Stats_Sqrt(sumsq / length);
+}
+
+void Stats_Block_Portable(const uint16_t *samples, uint32_t length, Stats_Result *stats){
+	uint32_t i, x, min, max, sum;
+	uint64_t sumsq;
+	
+	if (length == 0) {
+		stats->length = 0;
+		stats->min = stats->max = stats->mean = stats->rms = 0;
+		return;
+	}
+	
+	min = 0xFFFF;
+	max = 0;
+	sum = 0;
+	sumsq = 0;
+	for (i = 0; i < length; i++) {
+		x = samples[i];
+		if (x < min) min = x;
+		if (x > max) max = x;
+		sum += x;
+		sumsq += x * x;
+	}
+	
+	stats->min = (uint16_t) min;
+	stats->max = (uint16_t) max;
+	Stats_Finish(length, sum, sumsq, stats);
+}
@@ -0,0 +1,20 @@
+#ifndef __STM32L476G_DISCOVERY_STATS_H
+#define __STM32L476G_DISCOVERY_STATS_H
+
+// Plain C, no device header: also built and tested on the host (Tests/)
+#include <stdint.h>
+
+// Statistics of one block of samples
+typedef struct {
+	uint32_t length;   // Number of samples
+	uint16_t min;
+	uint16_t max;
+	uint16_t mean;     // Rounded to the nearest LSB
+	uint16_t rms;      // sqrt(mean of the squares), rounded down
+} Stats_Result;
+
+void Stats_Block(const uint16_t *samples, uint32_t length, Stats_Result *stats);
+void Stats_Block_Portable(const uint16_t *samples, uint32_t length, Stats_Result *stats);
+void Stats_Finish(uint32_t length, uint32_t sum, uint64_t sumsq, Stats_Result *stats);
+
+#endif /* __STM32L476G_DISCOVERY_STATS_H */
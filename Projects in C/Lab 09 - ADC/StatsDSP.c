@@ -0,0 +1,89 @@
+#include "Stats.h"
+#include "Intrinsics.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Block Statistics, SIMD version (see Stats.c)
+//  Stats_Block() uses the Cortex-M4 SIMD instructions on two 16-bit samples per 32-bit word:
+//    SMLAD  sum   += x0 * 1 + x1 * 1
+//    SMLALD sumsq += x0 * x0 + x1 * x1      (64-bit accumulator)
+//    USUB16 + SEL  per-halfword max and min
+//  The intrinsics come from the device header on the target. Tests/test_stats.c builds this
+//  file on the host with __ARM_FEATURE_DSP defined and the instructions emulated in C
+//  (Tests/DSP_Host.h), and compares it with Stats_Block_Portable().
+// ******************************************************************************************
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+
+void Stats_Block(const uint16_t *samples, uint32_t length, Stats_Result *stats){
+	const uint32_t *words;
+	uint32_t n, x0, x1, x, min, max, sum, total;
+	uint64_t sumsq;
+	
+	if (length == 0) {
+		Stats_Block_Portable(samples, length, stats);
+		return;
+	}
+	total = length;
+	
+	// Both halves start from the first sample
+	x = samples[0];
+	min = x | x << 16;
+	max = min;
+	sum = 0;
+	sumsq = 0;
+	
+	// Word-aligned loads: take one sample alone if the block starts on a half-word
+	if (((uintptr_t) samples & 2U) != 0) {
+		sum = x;
+		sumsq = x * x;
+		samples++;
+		length--;
+	}
+	words = (const uint32_t *) samples;
+	
+	// 4 samples per iteration
+	n = length >> 2;
+	while (n > 0) {
+		x0 = words[0];
+		x1 = words[1];
+		sum   = __SMLAD(x0, 0x00010001U, sum);
+		sum   = __SMLAD(x1, 0x00010001U, sum);
+		sumsq = __SMLALD(x0, x0, sumsq);
+		sumsq = __SMLALD(x1, x1, sumsq);
+		__USUB16(x0, max);               // GE[1:0] set where x0 >= max
+		max = __SEL(x0, max);
+		__USUB16(x0, min);               // GE[1:0] set where x0 >= min
+		min = __SEL(min, x0);
+		__USUB16(x1, max);
+		max = __SEL(x1, max);
+		__USUB16(x1, min);
+		min = __SEL(min, x1);
+		words += 2;
+		n--;
+	}
+	
+	// Remaining 0 to 3 samples
+	samples = (const uint16_t *) words;
+	n = length & 3U;
+	while (n > 0) {
+		x = *samples++;
+		sum += x;
+		sumsq += x * x;
+		if (x < (min & 0xFFFF)) min = (min & 0xFFFF0000U) | x;
+		if (x > (max & 0xFFFF)) max = (max & 0xFFFF0000U) | x;
+		n--;
+	}
+	
+	// Merge the two halves
+	stats->min = (uint16_t) ((min >> 16) < (min & 0xFFFF) ? (min >> 16) : (min & 0xFFFF));
+	stats->max = (uint16_t) ((max >> 16) > (max & 0xFFFF) ? (max >> 16) : (max & 0xFFFF));
+	Stats_Finish(total, sum, sumsq, stats);
+}
+
+#else
+
+void Stats_Block(const uint16_t *samples, uint32_t length, Stats_Result *stats){
+	Stats_Block_Portable(samples, length, stats);
+}
+
+#endif
@@ -3,7 +3,11 @@
 
 #include "stm32l476xx.h"
 
+#define  HSE_FREQUENCY  8000000U   // MCO of the ST-LINK when HSE bypass is used
+
 void System_Clock_Init(void);
+uint32_t System_Clock_Frequency(void);
+uint32_t System_APB1_Timer_Frequency(void);
 
 #endif /* __STM32L476G_DISCOVERY_DMA_H */
 
@@ -1,4 +1,5 @@
 #include "SysTimer.h"
+#include "SysClock.h"
 
 uint32_t msTicks;
 
@@ -15,7 +16,7 @@ void SysTick_Init(void){
 	SysTick->CTRL = 0;										// Disable SysTick IRQ and SysTick Counter
 	
 	// SysTick Reload Value Register
-	SysTick->LOAD = 80000000/1000 - 1;    // 1ms, Default clock
+	SysTick->LOAD = System_Clock_Frequency()/1000 - 1;    // 1ms at the current HCLK
 	
 	// SysTick Current Value Register
 	SysTick->VAL = 0;
@@ -54,3 +55,30 @@ void delay (uint32_t T){
 	
 	msTicks = 0;
 }
+
+// ******************************************************************************************
+// Cycle counter
+// The DWT cycle counter (CYCCNT) is a free-running 32-bit up-counter clocked by HCLK. It keeps
+// counting with interrupts disabled and wraps every 2^32 cycles (53 s at 80 MHz).
+// ******************************************************************************************
+void Cycle_Counter_Init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // Enable the trace and debug blocks (DWT)
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;             // Enable the cycle counter
+}
+
+// ******************************************************************************************
+// Delay in us
+// Busy-waits on CYCCNT. The cycle count is derived from the current clock configuration,
+// so the delay stays correct before System_Clock_Init() (MSI 4 MHz) and after it (80 MHz).
+// Does not depend on SysTick or on interrupts.
+// ******************************************************************************************
+void delay_us (uint32_t us){
+	uint32_t start, cycles;
+	
+	if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+		Cycle_Counter_Init();
+	
+	start  = DWT->CYCCNT;
+	cycles = (uint32_t) ((uint64_t) us * System_Clock_Frequency() / 1000000U);
+	while ((DWT->CYCCNT - start) < cycles);
+}
@@ -6,5 +6,7 @@
 void SysTick_Init(void);
 void SysTick_Handler(void);
 void delay (uint32_t T);
+void Cycle_Counter_Init(void);
+void delay_us (uint32_t us);
 
 #endif /* __STM32L476G_DISCOVERY_SYSTICK_H */
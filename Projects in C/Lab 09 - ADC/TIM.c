@@ -0,0 +1,107 @@
+#include "TIM.h"
+#include "SysClock.h"
+#include "stm32l476xx.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// GPIO PB6 as TIM4_CH1 for ADC triggers
+// TIM4_TRGO (OC1REF) starts one ADC conversion (or one scan sequence) per timer period.
+// ******************************************************************************************
+void TIM4_Init(uint32_t frequency){
+	
+	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM4EN; // Enable Clock of Timer 4
+	
+	TIM4->CR1  &= ~TIM_CR1_CEN;  // Disable counter while configuring
+	TIM4->CR1  &= ~TIM_CR1_CMS;  // Edge-aligned mode
+	TIM4->CR1  &= ~TIM_CR1_DIR;  // Counting direction: Up Counting
+ 	
+	// Master mode selection
+	// 000: UG bit from the TIMx_EGR register is used as trigger output (TRGO). 
+	// 001: Enable - the Counter Enable signal CNT_EN is used as trigger output (TRGO). 
+	// 010: Update - The update event is selected as trigger output (TRGO). 
+	// 011: Compare Pulse - The trigger output send a positive pulse when the CC1IF flag is to be set (even if it was already high).
+	// 100: Compare - OC1REF signal is used as trigger output (TRGO)
+	// 101: Compare - OC2REF signal is used as trigger output (TRGO)
+	// 110: Compare - OC3REF signal is used as trigger output (TRGO)
+	// 111: Compare - OC4REF signal is used as trigger output (TRGO)	
+	TIM4->CR2  &= ~TIM_CR2_MMS;  // Master mode selection
+	TIM4->CR2  |= TIM_CR2_MMS_2; // 100 = OC1REF as TRGO 
+	
+	// No timer interrupts: the ADC is started by TRGO without any CPU involvement
+	TIM4->DIER &= ~(TIM_DIER_TIE | TIM_DIER_UIE);
+	
+	// OC1M: Output Compare 1 mode
+	// 0110: PWM mode 1 - In upcounting, channel 1 is active as long as TIMx_CNT < TIMx_CCR1
+	// else inactive. The rising edge of OC1REF is at the update event.
+	TIM4->CCMR1 &= ~TIM_CCMR1_OC1M;
+	TIM4->CCMR1 |= TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_2;  // 0110 = PWM mode 1
+	
+	TIM4_Set_Frequency(frequency);
+	 
+	TIM4->CCER |= TIM_CCER_CC1E;  //  OC1 signal is output on the corresponding output pin
+	
+	// Enable timer
+	TIM4->CR1  |= TIM_CR1_CEN;   // Enable counter
+	
+	// Set up GPIO pin PB6 as TIM4_CH1 for debugging (trigger reference on the scope)
+	RCC->AHB2ENR  |= RCC_AHB2ENR_GPIOBEN;
+	GPIOB->MODER  &= ~(3U<<(2*6));
+	GPIOB->MODER  |=   2U<<(2*6);    // Input(00, reset), Output(01), AlterFunc(10), Analog(11, reset)
+	GPIOB->AFR[0] &= ~0x0F000000; 
+	GPIOB->AFR[0] |=  0x02000000;    // AF2 = TIM4_CH1 for PB6	
+}
+
+// ******************************************************************************************
+// Set the period of a 16-bit timer from a frequency in Hz
+// Frequency = APB1 timer clock / (1 + PSC) / (1 + ARR)
+// ******************************************************************************************
+static void TIM_Set_Period(TIM_TypeDef *TIMx, uint32_t frequency){
+	uint32_t ticks, prescaler;
+	
+	if (frequency == 0)
+		frequency = 1;
+	
+	ticks = System_APB1_Timer_Frequency() / frequency;    // Timer clock cycles per trigger
+	if (ticks < 2)
+		ticks = 2;
+	prescaler = ticks / 65536U;            // Smallest prescaler that keeps ARR within 16 bits
+	
+	TIMx->PSC  = prescaler;                              // max 65535
+	TIMx->ARR  = ticks / (prescaler + 1) - 1;            // max 65535
+}
+
+// ******************************************************************************************
+// Set the TIM4 trigger frequency in Hz
+// ******************************************************************************************
+void TIM4_Set_Frequency(uint32_t frequency){
+	TIM_Set_Period(TIM4, frequency);
+	TIM4->CCR1 = (TIM4->ARR + 1) / 2;                    // Duty ratio 50%
+	TIM4->EGR  = TIM_EGR_UG;                             // Load PSC now instead of at the next update
+}
+
+// ******************************************************************************************
+// TIM6 (basic timer) for low-rate background ADC triggers
+// TIM6_TRGO (update event) starts the injected sequence frequency times per second.
+// ******************************************************************************************
+void TIM6_Init(uint32_t frequency){
+	
+	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM6EN; // Enable Clock of Timer 6
+	
+	TIM6->CR1  &= ~TIM_CR1_CEN;  // Disable counter while configuring
+	
+	// Master mode selection
+	// 010: Update - The update event is selected as trigger output (TRGO)
+	TIM6->CR2  &= ~TIM_CR2_MMS;
+	TIM6->CR2  |= TIM_CR2_MMS_1;
+	
+	TIM6->DIER &= ~TIM_DIER_UIE; // No interrupt
+	
+	TIM_Set_Period(TIM6, frequency);
+	TIM6->EGR  = TIM_EGR_UG;     // Load PSC now instead of at the next update
+	
+	TIM6->CR1  |= TIM_CR1_CEN;   // Enable counter
+}
+
+void TIM6_Stop(void){
+	TIM6->CR1  &= ~TIM_CR1_CEN;
+}
@@ -0,0 +1,12 @@
+#ifndef __STM32L476G_DISCOVERY_TIM_H
+#define __STM32L476G_DISCOVERY_TIM_H
+
+#include "stm32l476xx.h"
+
+void TIM4_Init(uint32_t frequency);
+void TIM4_Set_Frequency(uint32_t frequency);
+void TIM6_Init(uint32_t frequency);
+void TIM6_Stop(void);
+
+#endif /* __STM32L476G_DISCOVERY_TIM_H */
+
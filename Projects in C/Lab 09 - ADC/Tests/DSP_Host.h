@@ -0,0 +1,40 @@
+#ifndef __STM32L476G_DISCOVERY_DSP_HOST_H
+#define __STM32L476G_DISCOVERY_DSP_HOST_H
+
+#include <stdint.h>
+
+// ******************************************************************************************
+// Host emulation of the Cortex-M4 DSP instructions used by StatsDSP.c, with the CMSIS names.
+// Included through Intrinsics.h only when a host test defines __ARM_FEATURE_DSP.
+//   SMLAD   acc + x.lo * y.lo + x.hi * y.hi                (signed halfwords)
+//   SMLALD  64-bit acc + x.lo * y.lo + x.hi * y.hi         (signed halfwords)
+//   USUB16  per-halfword a - b, GE[1:0] = (a.lo >= b.lo), GE[3:2] = (a.hi >= b.hi), unsigned
+//   SEL     per byte: GE[i] ? a : b
+// ******************************************************************************************
+static uint32_t DSP_Host_GE;
+
+static uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t acc){
+	return acc + (uint32_t) ((int32_t) (int16_t) x * (int16_t) y
+	                       + (int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16));
+}
+
+static uint64_t __SMLALD(uint32_t x, uint32_t y, uint64_t acc){
+	return acc + (uint64_t) ((int64_t) ((int32_t) (int16_t) x * (int16_t) y)
+	                       + (int64_t) ((int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16)));
+}
+
+static uint32_t __USUB16(uint32_t a, uint32_t b){
+	DSP_Host_GE = ((a & 0xFFFFU) >= (b & 0xFFFFU) ? 0x3U : 0U) | ((a >> 16) >= (b >> 16) ? 0xCU : 0U);
+	return (((a >> 16) - (b >> 16)) << 16) | ((a - b) & 0xFFFFU);
+}
+
+static uint32_t __SEL(uint32_t a, uint32_t b){
+	uint32_t i, result;
+	
+	result = 0;
+	for (i = 0; i < 4; i++)
+		result |= ((DSP_Host_GE >> i) & 1U ? a : b) & (0xFFU << (8 * i));
+	return result;
+}
+
+#endif /* __STM32L476G_DISCOVERY_DSP_HOST_H */
@@ -0,0 +1,168 @@
+#include "Codec.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// ******************************************************************************************
+// Host test of Codec.c
+//  1. Round trip: 3000 blocks of 1..600 samples (every 10th up to 65535) of full-scale
+//     16-bit noise, sine + noise, square and quiet DC must decode to the same samples, use
+//     no more than CODEC_MAX_BYTES(n) and report every byte as consumed. Length 0 and
+//     65536 are rejected, and so is an output buffer one byte too small.
+//  2. Stream: blocks encoded back to back decode one after the other.
+//  3. Truncation and corruption: every prefix of a block, a width field above 16 and a
+//     block larger than the decode buffer must return 0.
+//  4. Ratio: the four 512-sample waveforms of Benchmark_Codec() against the ratios of the
+//     README (4.8, 2.0, 3.6, 1.2).
+// ******************************************************************************************
+#define  MAX_LENGTH    65535U
+#define  BLOCKS        3000U
+
+static uint16_t Samples[MAX_LENGTH + 1], Decoded[MAX_LENGTH + 1];
+static uint8_t Encoded[CODEC_MAX_BYTES(MAX_LENGTH + 1)];
+static uint32_t Seed = 1;
+static uint32_t Failures;
+
+static void Check(int condition, const char *message){
+	if (!condition) {
+		printf("  FAIL: %s\n", message);
+		Failures++;
+	}
+}
+
+// Linear congruential generator, as in Benchmark.c
+static uint32_t Random(void){
+	Seed = Seed * 1664525U + 1013904223U;
+	return Seed;
+}
+
+// 0: full-scale 16-bit noise, 1: sine + noise, 2: square, 3: quiet DC
+static void Fill(uint16_t *samples, uint32_t length, uint32_t kind){
+	uint32_t i;
+
+	for (i = 0; i < length; i++) {
+		if (kind == 0)
+			samples[i] = (uint16_t) (Random() >> 16);
+		else if (kind == 1)
+			samples[i] = (uint16_t) (2048.0 + 1500.0 * sin(0.01 * i) + (Random() >> 30));
+		else if (kind == 2)
+			samples[i] = (uint16_t) ((i / 37) & 1 ? 4000 : 100);
+		else
+			samples[i] = (uint16_t) (2048 + (Random() >> 30));
+	}
+}
+
+static void Test_Round_Trip(void){
+	uint32_t block, length, used, consumed, n, errors, oversize;
+
+	errors = 0;
+	oversize = 0;
+	for (block = 0; block < BLOCKS; block++) {
+		length = 1 + Random() % (block % 10 == 0 ? MAX_LENGTH : 600);
+		Fill(Samples, length, block % 4);
+		used = Codec_Encode(Samples, length, Encoded, CODEC_MAX_BYTES(length));
+		if (used == 0 || used > CODEC_MAX_BYTES(length))
+			oversize++;
+		consumed = Codec_Decode(Encoded, used, Decoded, length, &n);
+		if (consumed != used || n != length || memcmp(Samples, Decoded, length * sizeof(uint16_t)) != 0)
+			errors++;
+		if (length > 1 && Codec_Encode(Samples, length, Encoded, used - 1) != 0)
+			errors++;
+	}
+	printf("  round trip: %u blocks, %u errors\n", BLOCKS, errors);
+	Check(oversize == 0, "every block fits in CODEC_MAX_BYTES(n)");
+	Check(errors == 0, "every block decodes to the same samples, and needs all its bytes");
+
+	Check(Codec_Encode(Samples, 0, Encoded, sizeof(Encoded)) == 0, "an empty block is rejected");
+	Check(Codec_Encode(Samples, MAX_LENGTH + 1, Encoded, sizeof(Encoded)) == 0, "more than 65535 samples are rejected");
+}
+
+static void Test_Stream(void){
+	static const uint32_t Lengths[4] = {512, 1, 17, 300};
+	uint32_t i, k, offset, size, consumed, n, errors, start;
+
+	size = 0;
+	start = 0;
+	for (i = 0; i < 4; i++) {
+		Fill(Samples + start, Lengths[i], i);
+		size += Codec_Encode(Samples + start, Lengths[i], Encoded + size, sizeof(Encoded) - size);
+		start += Lengths[i];
+	}
+
+	errors = 0;
+	offset = 0;
+	start = 0;
+	for (i = 0; i < 4; i++) {
+		consumed = Codec_Decode(Encoded + offset, size - offset, Decoded, MAX_LENGTH, &n);
+		if (consumed == 0 || n != Lengths[i])
+			errors++;
+		for (k = 0; k < n && k < Lengths[i]; k++)
+			if (Decoded[k] != Samples[start + k])
+				errors++;
+		offset += consumed;
+		start += Lengths[i];
+	}
+	Check(errors == 0 && offset == size, "a stream of blocks decodes block after block");
+}
+
+static void Test_Truncation(void){
+	uint32_t block, length, used, cut, n, accepted;
+
+	accepted = 0;
+	for (block = 0; block < 400; block++) {
+		length = 1 + Random() % 300;
+		Fill(Samples, length, block % 4);
+		used = Codec_Encode(Samples, length, Encoded, CODEC_MAX_BYTES(length));
+		for (cut = 0; cut < used; cut++)
+			if (Codec_Decode(Encoded, cut, Decoded, length, &n) != 0)
+				accepted++;
+		if (length > 1 && Codec_Decode(Encoded, used, Decoded, length - 1, &n) != 0)
+			accepted++;
+	}
+	Check(accepted == 0, "a truncated block or one larger than the buffer is rejected");
+
+	// Two samples: the header, then a width field of 31
+	Samples[0] = 100;
+	Samples[1] = 200;
+	used = Codec_Encode(Samples, 2, Encoded, sizeof(Encoded));
+	Encoded[CODEC_HEADER] |= 0x1F;
+	Check(Codec_Decode(Encoded, used, Decoded, 2, &n) == 0 && n == 0, "a width above 16 is rejected");
+}
+
+static void Test_Ratio(void){
+	static const char *Names[4] = {"quiet DC", "sine + noise", "square", "12-bit noise"};
+	static const double Documented[4] = {4.8, 2.0, 3.6, 1.2};
+	uint32_t i, waveform, noise, used;
+	double ratio;
+
+	Seed = 1;
+	for (waveform = 0; waveform < 4; waveform++) {
+		// Same blocks as Benchmark_Codec(), 12-bit sampled at 10 kHz
+		for (i = 0; i < 512; i++) {
+			noise = Random() >> 30;
+			if (waveform == 0)
+				Samples[i] = (uint16_t) (2048 + noise);
+			else if (waveform == 1)
+				Samples[i] = (uint16_t) (2048.0f + 1500.0f * sinf(6.2831853f * 100.0f * i / 10000.0f) + noise);
+			else if (waveform == 2)
+				Samples[i] = (uint16_t) ((i / 50) & 1 ? 4000 : 100);
+			else
+				Samples[i] = (uint16_t) (Seed >> 20);
+		}
+		used = Codec_Encode(Samples, 512, Encoded, CODEC_MAX_BYTES(512));
+		ratio = 2.0 * 512 / used;
+		printf("  %-12s %4u bytes, ratio %.2f\n", Names[waveform], used, ratio);
+		Check(fabs(ratio - Documented[waveform]) < 0.05, "ratio as documented in the README");
+	}
+}
+
+int main(void){
+	printf("test_codec\n");
+	Test_Round_Trip();
+	Test_Stream();
+	Test_Truncation();
+	Test_Ratio();
+	printf("test_codec: %s\n", Failures == 0 ? "PASS" : "FAIL");
+	return Failures != 0;
+}
@@ -0,0 +1,166 @@
+#include "Decimator.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ******************************************************************************************
+// Host test of Decimator.c (4-stage CIC, R = 16, 21-tap compensator, D = 2)
+//  Every output is compared with a double-precision model of the same pipeline: CIC =
+//  convolution with a length-R boxcar N times, sampled every R inputs, scaled by 2^-shift,
+//  then the FIR on every D-th CIC output. The fixed-point pipeline truncates the CIC output
+//  (< 1 LSB) and rounds the FIR output (0.5 LSB), so it must stay within
+//  sum|taps| / 32768 + 0.5 LSB of the model (16-bit output LSB, 16 = 1 ADC LSB).
+//  1. DC gain: a constant input c settles to exactly (c - 2048) * 16, for c = 0 .. 4095.
+//  2. Impulse and step responses against the model.
+//  3. 200,000 samples of full-scale random input (the integrators wrap modulo 2^32 many
+//     times), processed in odd block sizes, against the model.
+// ******************************************************************************************
+#define  STAGES      4
+#define  RATIO       16
+#define  FIR_RATIO   2
+#define  CIC_LENGTH  (STAGES * (RATIO - 1) + 1)
+#define  LONG_RUN    200000
+
+static Decimator Dec;
+static double Boxcar[CIC_LENGTH];
+static double Tolerance;
+static uint32_t Failures;
+
+static void Check(int condition, const char *message){
+	if (!condition) {
+		printf("  FAIL: %s\n", message);
+		Failures++;
+	}
+}
+
+// Impulse response of the CIC at the input rate: boxcar(R) convolved N times (sum R^N)
+static void Model_Init(void){
+	double next[CIC_LENGTH];
+	uint32_t s, i, k, length;
+	
+	Boxcar[0] = 1;
+	length = 1;
+	for (s = 0; s < STAGES; s++) {
+		for (i = 0; i < length + RATIO - 1; i++) {
+			next[i] = 0;
+			for (k = 0; k < RATIO; k++)
+				if (i >= k && i - k < length)
+					next[i] += Boxcar[i - k];
+		}
+		length += RATIO - 1;
+		for (i = 0; i < length; i++)
+			Boxcar[i] = next[i];
+	}
+	
+	Tolerance = 0.5;
+	for (i = 0; i < DECIMATOR_CIC4_R16_TAPS; i++)
+		Tolerance += fabs((double) Decimator_CIC4_R16_FIR[i]) / 32768.0;
+}
+
+// Outputs of the model for input[0 .. length - 1], from a reset state; returns the count
+static uint32_t Model_Process(const uint16_t *input, uint32_t length, double *output){
+	static double cic[LONG_RUN / RATIO + 1];
+	uint32_t m, i, k, j, n, count;
+	double v, acc;
+	
+	// CIC output m is taken after input m * R + R - 1
+	count = length / RATIO;
+	for (m = 0; m < count; m++) {
+		i = m * RATIO + RATIO - 1;
+		v = 0;
+		for (k = 0; k < CIC_LENGTH && k <= i; k++)
+			v += Boxcar[k] * ((double) input[i - k] - DECIMATOR_MIDSCALE);
+		cic[m] = v / (1 << (STAGES * 4 - 4));
+	}
+	
+	// FIR output after CIC outputs D - 1, 2D - 1, ..., taps[0] on the oldest
+	n = 0;
+	for (j = FIR_RATIO - 1; j < count; j += FIR_RATIO) {
+		acc = 0;
+		for (k = 0; k < DECIMATOR_CIC4_R16_TAPS; k++)
+			if (j + 1 + k >= DECIMATOR_CIC4_R16_TAPS)         // The history starts at 0
+				acc += Decimator_CIC4_R16_FIR[k] * cic[j + 1 + k - DECIMATOR_CIC4_R16_TAPS];
+		output[n++] = acc / 32768.0;
+	}
+	return n;
+}
+
+// Runs both in blocks of block samples and returns the largest difference
+static double Compare(const uint16_t *input, uint32_t length, uint32_t block){
+	static int16_t fixed[LONG_RUN / (RATIO * FIR_RATIO) + 1];
+	static double model[LONG_RUN / (RATIO * FIR_RATIO) + 1];
+	uint32_t i, n, m, size;
+	double worst;
+	
+	Decimator_Reset(&Dec);
+	n = 0;
+	for (i = 0; i < length; i += size) {
+		size = (length - i < block) ? length - i : block;
+		n += Decimator_Process(&Dec, &input[i], size, &fixed[n]);
+	}
+	m = Model_Process(input, length, model);
+	Check(n == m, "same number of outputs as the model");
+	
+	worst = 0;
+	for (i = 0; i < n && i < m; i++)
+		if (fabs(fixed[i] - model[i]) > worst)
+			worst = fabs(fixed[i] - model[i]);
+	return worst;
+}
+
+int main(void){
+	static uint16_t input[LONG_RUN];
+	static int16_t output[4096 / (RATIO * FIR_RATIO) + 1];
+	uint32_t i, c, n, settled, exact;
+	double error;
+	
+	printf("test_decimator\n");
+	Model_Init();
+	Check(Decimator_Init(&Dec, STAGES, RATIO, Decimator_CIC4_R16_FIR, DECIMATOR_CIC4_R16_TAPS, FIR_RATIO) == 1,
+	      "valid configuration is accepted");
+	Check(Decimator_Init(&Dec, 5, 128, Decimator_CIC4_R16_FIR, DECIMATOR_CIC4_R16_TAPS, FIR_RATIO) == 0,
+	      "12 + N * log2(R) > 32 is rejected");
+	Check(Decimator_Init(&Dec, 4, 12, Decimator_CIC4_R16_FIR, DECIMATOR_CIC4_R16_TAPS, FIR_RATIO) == 0,
+	      "R not a power of 2 is rejected");
+	
+	// 1. DC gain
+	exact = 0;
+	for (c = 0; c <= 4095; c++) {
+		for (i = 0; i < 4096; i++)
+			input[i] = (uint16_t) c;
+		Decimator_Reset(&Dec);
+		n = Decimator_Process(&Dec, input, 4096, output);
+		settled = 1;
+		for (i = (CIC_LENGTH / RATIO + DECIMATOR_CIC4_R16_TAPS) / FIR_RATIO + 1; i < n; i++)
+			if (output[i] != ((int32_t) c - DECIMATOR_MIDSCALE) * 16)
+				settled = 0;
+		exact += settled;
+	}
+	printf("  DC gain: %u of 4096 codes settle to exactly (c - 2048) * 16\n", exact);
+	Check(exact == 4096, "DC gain is exactly 16 per ADC LSB");
+	
+	// 2. Impulse (+2047 at input 100) and step (2048 -> 3071 at input 100)
+	for (i = 0; i < 4096; i++)
+		input[i] = (i == 100) ? 4095 : DECIMATOR_MIDSCALE;
+	error = Compare(input, 4096, 4096);
+	printf("  impulse: max error %.3f LSB (limit %.3f)\n", error, Tolerance);
+	Check(error <= Tolerance, "impulse response matches the model");
+	
+	for (i = 0; i < 4096; i++)
+		input[i] = (i < 100) ? DECIMATOR_MIDSCALE : 3071;
+	error = Compare(input, 4096, 4096);
+	printf("  step: max error %.3f LSB (limit %.3f)\n", error, Tolerance);
+	Check(error <= Tolerance, "step response matches the model");
+	
+	// 3. Long full-scale random run, blocks of 50 (not a multiple of R * D)
+	srand(1);
+	for (i = 0; i < LONG_RUN; i++)
+		input[i] = (uint16_t) (rand() & 4095);
+	error = Compare(input, LONG_RUN, 50);
+	printf("  random, %u samples in blocks of 50: max error %.3f LSB\n", LONG_RUN, error);
+	Check(error <= Tolerance, "wrapping integrators match the model");
+	
+	printf("test_decimator: %s\n", Failures == 0 ? "PASS" : "FAIL");
+	return Failures != 0;
+}
@@ -0,0 +1,153 @@
+#include "FFT.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ******************************************************************************************
+// Host test of FFT.c
+//  FFT_Q15() computes X[k] / FFT_SIZE. Each case is compared with a double-precision DFT of
+//  the same input divided by FFT_SIZE, as a signal to error ratio over all bins:
+//    SNR = 10 log10(sum |X|^2 / sum |X - FFT_Q15|^2)
+//  1. Random complex input, +-8192 per part, and full magnitude 32767 at random phases
+//     (the documented input limit |x| <= 32767).
+//  2. Single tone, full-scale real input.
+//  3. Worst case for the butterfly: four points beyond the limit (|x| = 46340) that make y1
+//     of the first stage 46341. It must clip to 32767: the SNR stays near 10 dB, where a
+//     wrap to -19196 gives about -3 dB. The same points scaled to |x| <= 32767 do not clip.
+//  4. FFT_Spectrum() on a 12-bit tone finds the expected bin and frequency.
+// ******************************************************************************************
+#define  PI          3.14159265358979323846
+
+static int16_t Data[2 * FFT_SIZE];
+static double  Input[2 * FFT_SIZE];
+static uint32_t Failures;
+
+static void Check(int condition, const char *message){
+	if (!condition) {
+		printf("  FAIL: %s\n", message);
+		Failures++;
+	}
+}
+
+// Loads Input[] into Data[], runs FFT_Q15 and returns the SNR in dB against the DFT
+static double Run(void){
+	static double cosine[FFT_SIZE], sine[FFT_SIZE];
+	uint32_t k, n, m;
+	double re, im, signal, error, dr, di;
+	
+	for (n = 0; n < FFT_SIZE; n++) {
+		cosine[n] = cos(2 * PI * n / FFT_SIZE);
+		sine[n]   = sin(2 * PI * n / FFT_SIZE);
+	}
+	for (n = 0; n < 2 * FFT_SIZE; n++)
+		Data[n] = (int16_t) Input[n];
+	FFT_Q15(Data);
+	
+	signal = 0;
+	error = 0;
+	for (k = 0; k < FFT_SIZE; k++) {
+		re = 0;
+		im = 0;
+		for (n = 0; n < FFT_SIZE; n++) {
+			m = (k * n) & (FFT_SIZE - 1);    // exp(-j 2 pi k n / N)
+			re += Input[2 * n] * cosine[m] + Input[2 * n + 1] * sine[m];
+			im += Input[2 * n + 1] * cosine[m] - Input[2 * n] * sine[m];
+		}
+		re /= FFT_SIZE;
+		im /= FFT_SIZE;
+		dr = Data[2 * k] - re;
+		di = Data[2 * k + 1] - im;
+		signal += re * re + im * im;
+		error  += dr * dr + di * di;
+	}
+	if (error == 0)
+		return 200;
+	return 10 * log10(signal / error);
+}
+
+static void Random_Case(int32_t amplitude, double limit){
+	uint32_t n;
+	double snr;
+	
+	for (n = 0; n < 2 * FFT_SIZE; n++)
+		Input[n] = (double) (rand() % (2 * amplitude + 1) - amplitude);
+	snr = Run();
+	printf("  random +-%d per part: SNR %.1f dB (limit %.0f dB)\n", amplitude, snr, limit);
+	Check(snr >= limit, "random input matches the DFT");
+}
+
+static void Random_Phase_Case(double limit){
+	uint32_t n;
+	double snr, phase;
+	
+	for (n = 0; n < FFT_SIZE; n++) {
+		phase = 2 * PI * rand() / ((double) RAND_MAX + 1);
+		Input[2 * n]     = floor(32767 * cos(phase));
+		Input[2 * n + 1] = floor(32767 * sin(phase));
+	}
+	snr = Run();
+	printf("  random phase, |x| = 32767: SNR %.1f dB (limit %.0f dB)\n", snr, limit);
+	Check(snr >= limit, "full-magnitude input matches the DFT");
+}
+
+// Four points of the first-stage butterfly n = FFT_SIZE / 8, scaled by gain
+static void Butterfly_Case(double gain){
+	uint32_t n;
+	
+	for (n = 0; n < 2 * FFT_SIZE; n++)
+		Input[n] = 0;
+	n = FFT_SIZE / 8;
+	Input[2 * n] = 32767;                           Input[2 * n + 1] = 32767;
+	Input[2 * (n + FFT_SIZE / 4)] = -32768;         Input[2 * (n + FFT_SIZE / 4) + 1] = 32767;
+	Input[2 * (n + FFT_SIZE / 2)] = -32768;         Input[2 * (n + FFT_SIZE / 2) + 1] = -32768;
+	Input[2 * (n + 3 * FFT_SIZE / 4)] = 32767;      Input[2 * (n + 3 * FFT_SIZE / 4) + 1] = -32768;
+	for (n = 0; n < 2 * FFT_SIZE; n++)
+		Input[n] = floor(Input[n] * gain);
+}
+
+int main(void){
+	static uint16_t samples[FFT_SIZE];
+	static uint16_t magnitude[FFT_BINS];
+	FFT_Peak peak;
+	uint32_t n;
+	double snr;
+	
+	printf("test_fft\n");
+	srand(1);
+	
+	// 1. Random complex input
+	Random_Case(8192, 35);
+	Random_Phase_Case(50);
+	
+	// 2. Tone at bin 37, full scale
+	for (n = 0; n < FFT_SIZE; n++) {
+		Input[2 * n] = floor(32767 * cos(2 * PI * 37 * n / FFT_SIZE) + 0.5);
+		Input[2 * n + 1] = 0;
+	}
+	snr = Run();
+	printf("  tone, bin 37: SNR %.1f dB (limit 60 dB)\n", snr);
+	Check(snr >= 60, "tone matches the DFT");
+	
+	// 3. First-stage butterfly n = FFT_SIZE / 8 (W = exp(-j pi / 4)):
+	//    t1 = a - c = 16384 + j16384, t3 = b - d = -16384 + j16384,
+	//    y1 = (t1 - j t3) * W = (32768 + j32768) * W = 46341 - j0 before saturation
+	Butterfly_Case(1.0);
+	snr = Run();
+	printf("  butterfly beyond the limit: SNR %.1f dB (clips: > 8 dB, wraps: < 0 dB)\n", snr);
+	Check(snr > 8, "butterfly output beyond 16 bits clips instead of wrapping");
+	Butterfly_Case(0.7071);
+	snr = Run();
+	printf("  same points within the limit: SNR %.1f dB (limit 60 dB)\n", snr);
+	Check(snr >= 60, "input within |x| <= 32767 does not clip");
+	
+	// 4. Spectrum of a 12-bit tone: bin 100 at 10 kHz (976.6 Hz for 1024 points)
+	for (n = 0; n < FFT_SIZE; n++)
+		samples[n] = (uint16_t) floor(2048 + 1500 * sin(2 * PI * 100 * n / FFT_SIZE) + 0.5);
+	FFT_Spectrum(samples, 10000, magnitude, &peak);
+	printf("  spectrum: peak bin %u, %u Hz, magnitude %u\n", peak.bin, peak.frequency, peak.magnitude);
+	Check(peak.bin == 100 && peak.frequency == (100 * 10000 + FFT_SIZE / 2) / FFT_SIZE, "dominant bin and frequency");
+	
+	printf("test_fft: %s\n", Failures == 0 ? "PASS" : "FAIL");
+	return Failures != 0;
+}
@@ -0,0 +1,104 @@
+#include "Millivolts.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// ******************************************************************************************
+// Host test and benchmark of Millivolts.c
+//  Sweeps every VREFINT code that gives 1.71 V <= VDDA <= 3.6 V, for three factory values
+//  VREFINT_CAL, and every raw code 0 .. 4095. The Q16 result is compared with the float
+//  reference raw * 3000 * VREFINT_CAL / VREFINT / 4095:
+//    - within 0.55 mV of raw * VDDA / 4095 (VDDA as rounded by Millivolts_VDDA): 0.5 mV of
+//      output rounding plus up to 4095 * 0.5 / 65536 = 0.03 mV from the rounding of scale;
+//    - within 1.05 mV of the unrounded reference (VDDA rounding adds up to 0.5 mV).
+//  At 10, 8 and 6 bits (full scale 1023, 255, 63) every code is within 0.55 mV of
+//  DATA * VDDA / full_scale, for every VDDA from 1.71 V to 3.6 V.
+//  The host vectorizes the float loop, so only the Cortex-M4 figures of Benchmark_Millivolts()
+//  say which one is faster on the board.
+//  Throughput of Millivolts_Convert and of the float loop on the host, in ns per sample.
+// ******************************************************************************************
+#define  SAMPLES     (MILLIVOLTS_FULL_SCALE + 1)
+#define  RUNS        20000
+
+static uint16_t Codes[SAMPLES];
+static uint16_t Fixed[SAMPLES];
+static float    Exact[SAMPLES];
+
+int main(void){
+	static const uint32_t cal[3] = { 1600, 1655, 1700 };
+	static const uint32_t full[3] = { 1023, 255, 63 };
+	uint32_t i, k, data, vdda, scale, failures, points;
+	double reference, error, error_rounded, worst, worst_rounded, sum;
+	clock_t start;
+	double ns_fixed, ns_float;
+	float gain;
+	
+	printf("test_millivolts\n");
+	for (i = 0; i < SAMPLES; i++)
+		Codes[i] = (uint16_t) i;
+	
+	failures = 0;
+	points = 0;
+	worst = 0;
+	worst_rounded = 0;
+	sum = 0;
+	for (k = 0; k < 3; k++) {
+		for (data = 1; data <= MILLIVOLTS_FULL_SCALE; data++) {
+			vdda = Millivolts_VDDA(cal[k], data);
+			if (vdda < 1710 || vdda > 3600)
+				continue;
+			scale = Millivolts_Scale(vdda, MILLIVOLTS_FULL_SCALE);
+			Millivolts_Convert(Codes, Fixed, SAMPLES, scale);
+			for (i = 0; i < SAMPLES; i++) {
+				reference = (double) i * MILLIVOLTS_CAL_VREF * cal[k] / data / MILLIVOLTS_FULL_SCALE;
+				error = fabs(Fixed[i] - reference);
+				error_rounded = fabs(Fixed[i] - (double) i * vdda / MILLIVOLTS_FULL_SCALE);
+				if (error > worst) worst = error;
+				if (error_rounded > worst_rounded) worst_rounded = error_rounded;
+				if (error > 1.05 || error_rounded > 0.55)
+					failures++;
+				sum += error;
+				points++;
+			}
+		}
+	}
+	printf("  %u conversions: max error %.3f mV (%.3f mV against the rounded VDDA), mean %.3f mV\n",
+	       points, worst, worst_rounded, sum / points);
+	
+	// Lower resolutions
+	worst = 0;
+	for (k = 0; k < 3; k++) {
+		for (vdda = 1710; vdda <= 3600; vdda++) {
+			scale = Millivolts_Scale(vdda, full[k]);
+			Millivolts_Convert(Codes, Fixed, full[k] + 1, scale);
+			for (i = 0; i <= full[k]; i++) {
+				error = fabs(Fixed[i] - (double) i * vdda / full[k]);
+				if (error > worst) worst = error;
+				if (error > 0.55)
+					failures++;
+			}
+		}
+	}
+	printf("  10, 8, 6-bit codes: max error %.3f mV\n", worst);
+	
+	// Throughput at VDDA = 3.0 V
+	scale = Millivolts_Scale(3000, MILLIVOLTS_FULL_SCALE);
+	start = clock();
+	for (k = 0; k < RUNS; k++)
+		Millivolts_Convert(Codes, Fixed, SAMPLES, scale + (k & 1));
+	ns_fixed = 1e9 * (double) (clock() - start) / CLOCKS_PER_SEC / ((double) RUNS * SAMPLES);
+	
+	start = clock();
+	for (k = 0; k < RUNS; k++) {
+		gain = (3000.0f + (float) (k & 1)) / MILLIVOLTS_FULL_SCALE;
+		for (i = 0; i < SAMPLES; i++)
+			Exact[i] = (float) Codes[i] * gain;
+	}
+	ns_float = 1e9 * (double) (clock() - start) / CLOCKS_PER_SEC / ((double) RUNS * SAMPLES);
+	printf("  host throughput: Q16 %.2f ns/sample, float %.2f ns/sample (last %.0f mV)\n",
+	       ns_fixed, ns_float, (double) Exact[SAMPLES - 1]);
+	
+	printf("test_millivolts: %s\n", failures == 0 ? "PASS" : "FAIL");
+	return failures != 0;
+}
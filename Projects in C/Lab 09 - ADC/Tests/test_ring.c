@@ -0,0 +1,132 @@
+#include "Ring.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ******************************************************************************************
+// Host test of Ring.c
+//  1. Full/empty boundary: exactly size samples fit, the next push is dropped and counted.
+//  2. Wraparound: head and tail start just below 2^32 and cross it.
+//  3. Ordering: a producer thread pushes a counting sequence while the consumer drains it
+//     in batches; every sample must come out once and in order. The producer waits while
+//     the ring is full, so that nothing is dropped.
+// ******************************************************************************************
+#define  RING_SIZE     64
+#define  SEQUENCE      1000000U
+
+static uint16_t Buffer[RING_SIZE];
+static Ring Queue;
+static uint32_t Failures;
+
+static void Check(int condition, const char *message){
+	if (!condition) {
+		printf("  FAIL: %s\n", message);
+		Failures++;
+	}
+}
+
+static void Test_Boundary(void){
+	uint16_t out[RING_SIZE + 1];
+	uint32_t i, n;
+	
+	Ring_Init(&Queue, Buffer, RING_SIZE);
+	Check(Ring_Count(&Queue) == 0, "new ring is empty");
+	Check(Ring_Read(&Queue, out, RING_SIZE) == 0, "read from an empty ring returns 0");
+	
+	for (i = 0; i < RING_SIZE; i++)
+		Check(Ring_Push(&Queue, (uint16_t) i) == 1, "push below size is stored");
+	Check(Ring_Count(&Queue) == RING_SIZE, "count is size when full");
+	Check(Ring_Push(&Queue, 0xFFFF) == 0, "push into a full ring is dropped");
+	Check(Queue.dropped == 1, "dropped sample is counted");
+	
+	n = Ring_Read(&Queue, out, RING_SIZE + 1);
+	Check(n == RING_SIZE, "read returns every stored sample");
+	for (i = 0; i < n; i++)
+		Check(out[i] == i, "full ring keeps the oldest samples in order");
+	Check(Ring_Count(&Queue) == 0, "ring is empty after draining");
+	
+	// Partial reads
+	for (i = 0; i < 10; i++)
+		Ring_Push(&Queue, (uint16_t) (100 + i));
+	Check(Ring_Read(&Queue, out, 4) == 4 && out[0] == 100 && out[3] == 103, "read of 4 of 10");
+	Check(Ring_Count(&Queue) == 6, "6 left after reading 4");
+	Check(Ring_Read(&Queue, out, 16) == 6 && out[0] == 104 && out[5] == 109, "read of the rest");
+}
+
+static void Test_Wraparound(void){
+	uint16_t out[RING_SIZE];
+	uint32_t i, round, n, next, expect;
+	
+	Ring_Init(&Queue, Buffer, RING_SIZE);
+	Queue.head = 0xFFFFFFF0U;
+	Queue.tail = 0xFFFFFFF0U;
+	
+	next = 0;
+	expect = 0;
+	for (round = 0; round < 8; round++) {
+		for (i = 0; i < RING_SIZE - 5; i++)
+			Ring_Push(&Queue, (uint16_t) next++);
+		Check(Ring_Count(&Queue) == RING_SIZE - 5, "count across the 2^32 wrap");
+		n = Ring_Read(&Queue, out, RING_SIZE);
+		Check(n == RING_SIZE - 5, "read across the 2^32 wrap");
+		for (i = 0; i < n; i++)
+			Check(out[i] == (uint16_t) expect++, "order across the 2^32 wrap");
+	}
+	Check(Queue.head < 0xFFFFFFF0U, "head has wrapped");
+	
+	// Full exactly at the wrap
+	Queue.head = 0xFFFFFFF8U;
+	Queue.tail = 0xFFFFFFF8U;
+	for (i = 0; i < RING_SIZE; i++)
+		Ring_Push(&Queue, (uint16_t) i);
+	Check(Ring_Count(&Queue) == RING_SIZE && Ring_Push(&Queue, 0) == 0, "full across the wrap");
+}
+
+static void *Producer(void *argument){
+	uint32_t i;
+	
+	(void) argument;
+	for (i = 0; i < SEQUENCE; i++) {
+		while (Ring_Count(&Queue) == RING_SIZE)
+			sched_yield();
+		Ring_Push(&Queue, (uint16_t) i);
+	}
+	return 0;
+}
+
+static void Test_Ordering(void){
+	pthread_t thread;
+	uint16_t out[16];
+	uint32_t received, n, i, errors;
+	
+	Ring_Init(&Queue, Buffer, RING_SIZE);
+	received = 0;
+	errors = 0;
+	pthread_create(&thread, 0, Producer, 0);
+	
+	while (received < SEQUENCE) {
+		n = Ring_Read(&Queue, out, 16);
+		if (n == 0)
+			sched_yield();
+		for (i = 0; i < n; i++)
+			if (out[i] != (uint16_t) (received + i))
+				errors++;
+		received += n;
+	}
+	pthread_join(thread, 0);
+	
+	printf("  ordering: %u samples, %u out of order, %u dropped\n", received, errors, Queue.dropped);
+	Check(received == SEQUENCE && Ring_Count(&Queue) == 0, "every sample is received once");
+	Check(errors == 0, "samples come out in the order they were pushed");
+	Check(Queue.dropped == 0, "nothing is dropped when the producer waits");
+}
+
+int main(void){
+	printf("test_ring\n");
+	Test_Boundary();
+	Test_Wraparound();
+	Test_Ordering();
+	printf("test_ring: %s\n", Failures == 0 ? "PASS" : "FAIL");
+	return Failures != 0;
+}
@@ -0,0 +1,72 @@
+#include "Stats.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ******************************************************************************************
+// Host test of Stats.c against StatsDSP.c
+//  StatsDSP.c is built with __ARM_FEATURE_DSP = 1 and the SIMD instructions emulated in C
+//  (DSP_Host.h), so the same packed-halfword code that runs on the board is exercised.
+//  1. A hand-checked block: min, max, rounded mean and floor of the RMS.
+//  2. 20,000 random blocks: every length 0 .. 1000 (all remainders mod 4), start on a word
+//     and on a half-word, 12-bit and 15-bit samples, extremes at the first, middle and last
+//     positions. Stats_Block() and Stats_Block_Portable() must agree exactly.
+// ******************************************************************************************
+static uint32_t Failures;
+
+static void Check(int condition, const char *message){
+	if (!condition) {
+		printf("  FAIL: %s\n", message);
+		Failures++;
+	}
+}
+
+int main(void){
+	static uint32_t words[1002 / 2];          // 32-bit aligned storage for the samples
+	uint16_t *buffer = (uint16_t *) words;
+	Stats_Result simd, portable;
+	uint32_t t, i, offset, length, limit, mismatches;
+	
+	printf("test_stats\n");
+	
+	// 1. 3, 3, 3, 5, 3, 3, 3, 3: mean 3.25 -> 3, RMS sqrt(88 / 8) = 3.31 -> 3
+	for (i = 0; i < 8; i++)
+		buffer[i] = 3;
+	buffer[3] = 5;
+	Stats_Block_Portable(buffer, 8, &portable);
+	Check(portable.length == 8 && portable.min == 3 && portable.max == 5, "min and max");
+	Check(portable.mean == 3 && portable.rms == 3, "rounded mean and floor of the RMS");
+	Stats_Block_Portable(buffer, 0, &portable);
+	Check(portable.length == 0 && portable.mean == 0, "empty block");
+	
+	// 2. SIMD against portable
+	srand(1);
+	mismatches = 0;
+	for (t = 0; t < 20000; t++) {
+		offset = t & 1U;
+		length = (t < 1001) ? t : (uint32_t) rand() % 1001;
+		limit  = (t & 2U) ? 4095 : 32767;
+		for (i = 0; i < 1002; i++)
+			buffer[i] = (uint16_t) (rand() % (limit + 1));
+		if (length != 0 && (t & 4U)) {
+			buffer[offset] = 0;
+			buffer[offset + length / 2] = (uint16_t) limit;
+			buffer[offset + length - 1] = (uint16_t) (t & 8U ? 0 : limit);
+		}
+		Stats_Block(buffer + offset, length, &simd);
+		Stats_Block_Portable(buffer + offset, length, &portable);
+		if (simd.length != portable.length || simd.min != portable.min || simd.max != portable.max
+		 || simd.mean != portable.mean || simd.rms != portable.rms) {
+			if (mismatches == 0)
+				printf("  first mismatch: length %u offset %u: min %u/%u max %u/%u mean %u/%u rms %u/%u\n",
+				       length, offset, simd.min, portable.min, simd.max, portable.max,
+				       simd.mean, portable.mean, simd.rms, portable.rms);
+			mismatches++;
+		}
+	}
+	printf("  %u random blocks, %u mismatches between SIMD and portable\n", t, mismatches);
+	Check(mismatches == 0, "Stats_Block equals Stats_Block_Portable");
+	
+	printf("test_stats: %s\n", Failures == 0 ? "PASS" : "FAIL");
+	return Failures != 0;
+}
@@ -4,13 +4,73 @@
 #include "LED.h"            // Include LED header file
 #include "SysTimer.h"       // Include SysTimer header file
 #include "SysClock.h"       // Include SysClock header file
+#include "Decimator.h"      // Include Decimator header file
+#include "Stats.h"          // Include Stats header file
+#include "FFT.h"            // Include FFT header file
 
-volatile uint32_t result;   // Declare a volatile variable to store ADC conversion result
+#define SAMPLE_RATE 10000   // ADC sample rate in Hz
+
+volatile uint32_t result;   // Latest PA1 voltage in mV
+
+#define SCAN_LENGTH 2       // Number of channels in the scan sequence
+
+// PA1 (ADC12_IN6) and PA2 (ADC12_IN7) are converted one after the other on every trigger
+const ADC_Channel Scan_Sequence[SCAN_LENGTH] = {
+    { 6, ADC_SMP_24_5 },    // PA1: ADC12_IN6
+    { 7, ADC_SMP_24_5 }     // PA2: ADC12_IN7
+};
+
+uint16_t ADC_Buffer[2 * ADC_SAMPLE_SIZE];   // Circular buffer filled by DMA, two halves of ADC_SAMPLE_SIZE
+
+uint16_t PA1_Samples[ADC_SAMPLE_SIZE / SCAN_LENGTH];   // De-interleaved samples of PA1
+uint16_t PA2_Samples[ADC_SAMPLE_SIZE / SCAN_LENGTH];   // De-interleaved samples of PA2
+uint16_t * const Channel_Samples[SCAN_LENGTH] = { PA1_Samples, PA2_Samples };
+uint16_t PA1_Millivolts[ADC_SAMPLE_SIZE / SCAN_LENGTH]; // PA1 in mV, independent of the supply voltage
+
+// PA1 decimated by 32 (CIC 4 stages x 16, compensating FIR x 2): 10 kHz -> 312.5 Hz
+Decimator PA1_Decimator;
+int16_t PA1_Decimated[ADC_SAMPLE_SIZE / SCAN_LENGTH / 32 + 1];
+volatile int32_t filtered;  // Latest decimated PA1 sample, 16 = 1 LSB, 0 = mid-scale
+
+Stats_Result PA1_Stats;     // min, max, mean and RMS of the latest PA1 block
+
+// Spectrum mode: FFT_SIZE consecutive PA1 samples are captured by the DMA interrupt and
+// analysed in the main loop, then the next capture starts
+uint16_t Spectrum_Capture[FFT_SIZE];
+uint16_t Spectrum[FFT_BINS];        // Magnitude of bin k at k * SAMPLE_RATE / FFT_SIZE Hz
+FFT_Peak Spectrum_Peak;             // Dominant frequency of the last capture
+volatile uint32_t Spectrum_Count;   // Samples captured, FFT_SIZE when the capture is complete
+
+// Runs in the DMA interrupt each time one half of ADC_Buffer is filled
+void ADC_Block_Ready(uint16_t *samples, uint32_t length){
+    uint32_t n;
+    
+    GPIOD->ODR |= GPIO_ODR_ODR_0;   // Set PD 0 pin high
+    ADC_Scan_Deinterleave(samples, length, Channel_Samples, SCAN_LENGTH);
+    ADC_To_Millivolts(PA1_Samples, PA1_Millivolts, length / SCAN_LENGTH);
+    result = PA1_Millivolts[length / SCAN_LENGTH - 1];   // Store the latest voltage of PA1
+    
+    Stats_Block(PA1_Samples, length / SCAN_LENGTH, &PA1_Stats);
+    
+    for (n = 0; n < length / SCAN_LENGTH && Spectrum_Count < FFT_SIZE; n++)
+        Spectrum_Capture[Spectrum_Count++] = PA1_Samples[n];
+    
+    n = Decimator_Process(&PA1_Decimator, PA1_Samples, length / SCAN_LENGTH, PA1_Decimated);
+    if (n != 0)
+        filtered = PA1_Decimated[n - 1];
+}
+
+// Runs in ADC1_2_IRQHandler the first time PA1 leaves the watchdog window
+void PA1_Out_Of_Window(uint32_t watchdog){
+    (void) watchdog;    // Only AWD1 is configured with this callback
+    Red_LED_On();
+}
 
 int main(void){
 
     System_Clock_Init();    							// Initialize system clock to 80 MHz
     SysTick_Init();         							// Initialize SysTick timer
+    LED_Init();             							// Initialize LEDs
 
     LCD_PIN_Init();         							// Initialize LCD GPIO pins
     LCD_Clock_Init();       							// Initialize LCD clock
@@ -20,16 +80,30 @@ int main(void){
     LCD_bar();              							// Draw a bar on LCD screen
 
     ADC_Init();             							// Initialize ADC
+    ADC_Scan_Config(Scan_Sequence, SCAN_LENGTH);       // Convert PA1 and PA2 on every trigger
+    
+    // TIM4_TRGO triggers ADC1 at a fixed sample rate
+    // GPIO PB6 (TIM4_CH1) is outputed for debugging
+    ADC_Timer_Trigger_Init(SAMPLE_RATE);
+    
+    // Analog watchdog 1 on PA1: Red LED on when PA1 goes below 1024 or above 3072
+    ADC_AWD_Config(1, 6, 1024, 3072, PA1_Out_Of_Window);
+    
+    Decimator_Init(&PA1_Decimator, 4, 16, Decimator_CIC4_R16_FIR, DECIMATOR_CIC4_R16_TAPS, 2);
+    
+    // Temperature, VBAT and VDDA measured 10 times per second by TIM6-triggered injected conversions
+    ADC_Sensors_Start(10);
+    
+    // DMA fills ADC_Buffer without CPU involvement
+    ADC_DMA_Start(ADC_Buffer, 2 * ADC_SAMPLE_SIZE, ADC_Block_Ready, ADC_Block_Ready);
 
     while(1){
-        // while(Microphone_DMA_Done == 0);
-        GPIOD->ODR |= GPIO_ODR_ODR_0;  // Set PD 0 pin high
-
-        ADC1->CR |= ADC_CR_ADSTART; // Start ADC conversion
-        while ( (ADC123_COMMON->CSR & ADC_CSR_EOC_MST) == 0); // Wait for ADC conversion to complete
-        result = ADC1->DR; // Store ADC conversion result
-
         GPIOD->ODR &= ~GPIO_ODR_ODR_0; // Set PD 0 pin low 
+        __WFI();                       // Sleep until the next DMA half/full transfer interrupt
+        if (Spectrum_Count == FFT_SIZE) {
+            FFT_Spectrum(Spectrum_Capture, SAMPLE_RATE, Spectrum, &Spectrum_Peak);
+            Spectrum_Count = 0;        // Start the next capture
+        }
         // The duty ratio of the signal on PD 0 represents CPU utilization
     }
 }
@@ -1,7 +1,7 @@
 #include "DAC.h"
 #include "LED.h"
 #include "SysTimer.h"
-#include "SysTimer.h"
+#include "SysClock.h"
 
 #include "stm32l476xx.h"
 #include <stdint.h>
@@ -49,12 +49,28 @@ void DAC_Pin_Configuration(void){
 
 // ******************************************************************************************
 // DAC Configuration
+//  The DWT cycle counter times the whole function: DAC_Configuration_Cycles() and
+//  DAC_Calibration_Restored() tell what a cold (calibrated) or warm (restored) boot cost.
 // ******************************************************************************************
+static uint32_t DAC_Configuration_Time;
+static uint32_t DAC_Configuration_Warm;
+
+static void DAC_Cycle_Counter_Init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 void DAC_Configuration(void){
+	uint32_t start;
+	
+	DAC_Cycle_Counter_Init();
+	start = DWT->CYCCNT;
 	
 	RCC->APB1ENR1 |= RCC_APB1ENR1_DAC1EN;  // Enable DAC Clock
 	
-	DAC_Calibration_Channel(2);  // Calibrate DAC Channel 2 because it is related with PA5 which is available on our board
+	DAC_Configuration_Warm = DAC_Calibration_Restore(2);
+	if (DAC_Configuration_Warm == 0)  // Cold boot: no trim stored in the backup domain
+		DAC_Calibration_Channel(2);  // Calibrate DAC Channel 2 because it is related with PA5 which is available on our board
 	// Unlike channel 1 which we cann't use because it is connected to a pin that is not available on our board
 
 	// DAC mode control register (DAC_MCR)
@@ -89,6 +105,210 @@ void DAC_Configuration(void){
 	DAC->CR |=  DAC_CR_EN2;       // Enable DAC Channel 2
 	
 	delay(1);
+	
+	DAC_Configuration_Time = DWT->CYCCNT - start;
+}
+
+// CPU cycles of the last DAC_Configuration()
+uint32_t DAC_Configuration_Cycles(void){
+	return DAC_Configuration_Time;
+}
+
+// 1: the last DAC_Configuration() restored the stored OTRIM (warm), 0: it calibrated (cold)
+uint32_t DAC_Calibration_Restored(void){
+	return DAC_Configuration_Warm;
+}
+
+// ******************************************************************************************
+// DAC Sample and Hold Mode
+//  MODE2 = 100: external pin, buffer enabled. The DAC drives the pin only during the sample
+//  phase (TSAMPLE2) after a conversion and during the refresh phases (TREFRESH2), repeated
+//  every THOLD2; in between it is off and the hold capacitor keeps the voltage.
+//  This cuts the DAC supply current for a slowly changing setpoint.
+//  The three times are counted in LSI cycles (31.25 us at 32 kHz), rounded up:
+//    TSAMPLE2  10 bits (SHSR2), THOLD2 10 bits (SHHR), TREFRESH2 8 bits (SHRR)
+//  MODE2, SHHR and SHRR may only be written while the channel is disabled: the channel is
+//  disabled here and re-enabled once configured.
+// ******************************************************************************************
+static uint32_t DAC_LSI_Ticks(uint32_t us, uint32_t max){
+	uint32_t ticks;
+	
+	ticks = (uint32_t) (((uint64_t) us * DAC_LSI_FREQ + 999999U) / 1000000U);
+	if (ticks < 1)
+		ticks = 1;
+	if (ticks > max)
+		ticks = max;
+	return ticks;
+}
+
+void DAC_SampleHold_Config(uint32_t sample_us, uint32_t hold_us, uint32_t refresh_us){
+	
+	// The sample and hold timing is clocked by LSI
+	RCC->CSR |= RCC_CSR_LSION;
+	while ((RCC->CSR & RCC_CSR_LSIRDY) == 0);
+	
+	DAC->CR &= ~DAC_CR_EN2;       // Disable DAC Channel 2
+	
+	DAC->MCR &= ~DAC_MCR_MODE2;
+	DAC->MCR |=  DAC_MCR_MODE2_2; // 100: sample & hold, external pin, buffer enabled
+	
+	DAC->SHSR2 = DAC_LSI_Ticks(sample_us, 0x3FF);
+	DAC->SHHR  = (DAC->SHHR & ~DAC_SHHR_THOLD2)     | (DAC_LSI_Ticks(hold_us, 0x3FF) << 16);
+	DAC->SHRR  = (DAC->SHRR & ~DAC_SHRR_TREFRESH2)  | (DAC_LSI_Ticks(refresh_us, 0xFF) << 16);
+	
+	DAC->CR |=  DAC_CR_EN2;       // Enable DAC Channel 2
+}
+
+// ******************************************************************************************
+// Change the sample time while the channel is running, without waiting.
+// Each write of SHSR2 is synchronized to LSI (about 3 LSI periods, BWST2 = 1); a write in
+// that window is ignored. Returns 1 if written, 0 if busy: try again later.
+// ******************************************************************************************
+uint32_t DAC_SampleHold_Set_Sample(uint32_t sample_us){
+	if ((DAC->SR & DAC_SR_BWST2) != 0)
+		return 0;
+	DAC->SHSR2 = DAC_LSI_Ticks(sample_us, 0x3FF);
+	return 1;
+}
+
+// ******************************************************************************************
+// New 12-bit output value, converted on the software trigger.
+// DHR12R2 is not affected by BWST2 (it only guards SHSR2): no wait in either mode.
+// ******************************************************************************************
+void DAC_Write(uint32_t value){
+	DAC->DHR12R2 = value;
+	DAC->SWTRIGR = DAC_SWTRIGR_SWTRIG2;   // Cleared by hardware once DHR is transferred
+}
+
+// ******************************************************************************************
+// DAC Offset Trim Storage
+//  The result of DAC_Calibration_Channel() (OTRIM, 5 bits) is kept in the RTC backup
+//  registers, which survive a reset (warm boot) as long as VDD or VBAT is present. At init,
+//  DAC_Calibration_Restore() loads it instead of running the binary search: 4 steps and a
+//  final check, each after a delay(1). delay(1) lasts until the next SysTick tick, so the
+//  first one takes 0 to 1 ms and the others about 1 ms: 4 to 5 ms per channel, against
+//  about 0.14 ms for the temperature reading (120 us start-up and two 8 us conversions).
+//  The offset drifts with temperature, so one value is kept per channel and per band of
+//  DAC_TRIM_BAND_WIDTH degC, from the internal temperature sensor (ADC1_IN17):
+//    BKPxR, x = DAC_TRIM_BKP + (channel - 1) * DAC_TRIM_BANDS + band
+//    bits 31:16 = DAC_TRIM_MAGIC, bits 4:0 = OTRIM
+//  A cold boot (backup domain reset) clears them: the full calibration runs and stores its
+//  result in the band read by DAC_Calibration_Restore(): the temperature is read once per
+//  boot. To force it, call DAC_Calibration_Channel() directly (it reads the band again).
+//  Needs write access to the backup domain (DBP), set in LCD_Clock_Init().
+// ******************************************************************************************
+
+// Busy wait on the DWT cycle counter, at the current HCLK
+static void DAC_Wait_us(uint32_t us){
+	uint32_t start, cycles;
+	
+	DAC_Cycle_Counter_Init();
+	cycles = us * (System_Clock_Frequency() / 1000000U);
+	start = DWT->CYCCNT;
+	while ((DWT->CYCCNT - start) < cycles);
+}
+
+// ******************************************************************************************
+// One coarse temperature reading (degC) with ADC1, which is left disabled afterwards.
+// VDDA is taken as 3.0 V (the calibration voltage): good enough to select a band.
+// ******************************************************************************************
+static int32_t DAC_Temperature(void){
+	uint32_t data, n;
+	int32_t cal1, cal2;
+	
+	RCC->AHB2ENR |= RCC_AHB2ENR_ADCEN;         // Enable ADC Clock
+	
+	// CKMODE = 01: HCLK/1 (synchronous clock), TSEN: temperature sensor enable
+	// Both are writable only while all ADCs are disabled
+	ADC123_COMMON->CCR &= ~ADC_CCR_CKMODE;
+	ADC123_COMMON->CCR |=  ADC_CCR_CKMODE_0 | ADC_CCR_TSEN;
+	
+	ADC1->CR &= ~ADC_CR_DEEPPWD;               // Exit deep power down
+	ADC1->CR |=  ADC_CR_ADVREGEN;              // Enable the voltage regulator
+	DAC_Wait_us(120);                          // Regulator (20 us) and sensor (120 us) start-up
+	
+	ADC1->ISR = ADC_ISR_ADRDY;
+	ADC1->CR |= ADC_CR_ADEN;
+	while ((ADC1->ISR & ADC_ISR_ADRDY) == 0);
+	
+	ADC1->SQR1 = 17U << 6;                     // L = 0 (1 conversion), SQ1 = 17 (VTS)
+	ADC1->SMPR2 |= ADC_SMPR2_SMP17;            // 111: 640.5 cycles = 8 us, VTS needs 5 us
+	
+	// Two conversions: the first one after the ADC has been idle is not accurate (errata)
+	data = 0;
+	for (n = 0; n < 2; n++) {
+		ADC1->CR |= ADC_CR_ADSTART;
+		while ((ADC1->ISR & ADC_ISR_EOC) == 0);
+		data = ADC1->DR;
+	}
+	
+	ADC1->CR |= ADC_CR_ADDIS;
+	while ((ADC1->CR & ADC_CR_ADEN) != 0);
+	ADC1->CR &= ~ADC_CR_ADVREGEN;
+	ADC1->CR |=  ADC_CR_DEEPPWD;
+	ADC123_COMMON->CCR &= ~ADC_CCR_TSEN;
+	
+	cal1 = *TS_CAL1_ADDR;
+	cal2 = *TS_CAL2_ADDR;
+	if (cal2 == cal1)
+		return TS_CAL1_TEMP;
+	return (TS_CAL2_TEMP - TS_CAL1_TEMP) * ((int32_t) data - cal1) / (cal2 - cal1) + TS_CAL1_TEMP;
+}
+
+static uint32_t DAC_Trim_Band;          // Temperature band of the last reading
+static uint32_t DAC_Trim_Band_Pending;  // 1: read by a restore that found nothing, for the save
+
+static void DAC_Trim_Band_Read(void){
+	int32_t band;
+	
+	band = (DAC_Temperature() - DAC_TRIM_BAND_MIN) / DAC_TRIM_BAND_WIDTH;
+	if (band < 0)
+		band = 0;
+	if (band > DAC_TRIM_BANDS - 1)
+		band = DAC_TRIM_BANDS - 1;
+	DAC_Trim_Band = (uint32_t) band;
+}
+
+// Backup register of the channel in the band of the last reading
+static volatile uint32_t *DAC_Trim_Register(uint32_t channel){
+	return &RTC->BKP0R + DAC_TRIM_BKP + (channel - 1) * DAC_TRIM_BANDS + DAC_Trim_Band;
+}
+
+// ******************************************************************************************
+// Load the stored OTRIM of the channel. Returns 1 if found, 0 if it must be calibrated.
+// ******************************************************************************************
+uint32_t DAC_Calibration_Restore(uint32_t channel){
+	uint32_t record, trim;
+	
+	DAC_Trim_Band_Read();
+	record = *DAC_Trim_Register(channel);
+	if ((record >> 16) != DAC_TRIM_MAGIC) {
+		DAC_Trim_Band_Pending = 1;            // The calibration that follows saves in this band
+		return 0;
+	}
+	
+	DAC_Trim_Band_Pending = 0;
+	trim = record & 0x1F;
+	if (channel == 1) {
+		DAC->CCR &= ~DAC_CCR_OTRIM1;
+		DAC->CCR |= trim;
+	} else {
+		DAC->CCR &= ~DAC_CCR_OTRIM2;
+		DAC->CCR |= trim << 16;
+	}
+	return 1;
+}
+
+// Store OTRIM of the channel for the current temperature band
+static void DAC_Calibration_Save(uint32_t channel, uint32_t trim){
+	
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;       // Power interface clock enable
+	PWR->CR1 |= PWR_CR1_DBP;                   // Enable write access to Backup domain
+	
+	if (DAC_Trim_Band_Pending == 0)
+		DAC_Trim_Band_Read();
+	DAC_Trim_Band_Pending = 0;
+	*DAC_Trim_Register(channel) = (DAC_TRIM_MAGIC << 16) | (trim & 0x1F);
 }
 
 // ******************************************************************************************
@@ -163,4 +383,6 @@ void DAC_Calibration_Channel(uint32_t channel){
 	}
 	
 	DAC->CR &= ~DAC_CR_CEN_Flag; 
+	
+	DAC_Calibration_Save(channel, trimmingvalue);
 }
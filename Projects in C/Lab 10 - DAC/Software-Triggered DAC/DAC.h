@@ -3,10 +3,42 @@
 
 #include "stm32l476xx.h"
 
+// Stored offset trim (see DAC_Calibration_Restore)
+#define  DAC_TRIM_BKP          8U        // First RTC backup register used (BKP8R)
+#define  DAC_TRIM_BANDS        8         // Temperature bands per channel (BKP8R..BKP23R)
+#define  DAC_TRIM_BAND_MIN     (-40)     // degC, lower edge of band 0
+#define  DAC_TRIM_BAND_WIDTH   20        // degC
+#define  DAC_TRIM_MAGIC        0xDAC0U   // Marks a valid record (bits 31:16)
+
+// Temperature sensor factory calibration, raw data acquired at VDDA = 3.0 V
+#define  TS_CAL1_ADDR          ((uint16_t *) 0x1FFF75A8U)
+#define  TS_CAL2_ADDR          ((uint16_t *) 0x1FFF75CAU)
+#define  TS_CAL1_TEMP          30        // degC
+#define  TS_CAL2_TEMP          110       // degC
+
+// Sample and hold mode, clocked by LSI (see DAC_SampleHold_Config)
+#define  DAC_LSI_FREQ               32000U    // Hz, nominal
+#define  DAC_SH_LEAKAGE_NA          10U       // Hold leakage current (assumed worst case), nA
+#define  DAC_SH_DROOP_UV            733U      // Allowed droop during hold: 1 LSB = 3.0 V / 4095
+
+// Times in us for an external hold capacitor of c nF on PA5 (DAC1_OUT2), buffer enabled:
+//   sample:  full-scale settling, datasheet tSAMP = 0.7 ms with 100 nF
+//   hold:    time for the leakage to discharge the capacitor by DAC_SH_DROOP_UV (dV = I t / C)
+//   refresh: one time constant, enough to restore a droop of 1 LSB
+#define  DAC_SH_SAMPLE_US(c)        (7U * (c))
+#define  DAC_SH_HOLD_US(c)          ((c) * DAC_SH_DROOP_UV / DAC_SH_LEAKAGE_NA)
+#define  DAC_SH_REFRESH_US(c)       (DAC_SH_SAMPLE_US(c) / 8U)
+
 void DAC_Init(void);
 void DAC_Pin_Configuration(void);
 void DAC_Configuration(void);
 void DAC_Calibration_Channel(uint32_t channel);
+uint32_t DAC_Calibration_Restore(uint32_t channel);
+uint32_t DAC_Calibration_Restored(void);
+uint32_t DAC_Configuration_Cycles(void);
+void DAC_SampleHold_Config(uint32_t sample_us, uint32_t hold_us, uint32_t refresh_us);
+uint32_t DAC_SampleHold_Set_Sample(uint32_t sample_us);
+void DAC_Write(uint32_t value);
 
 #endif /* __STM32L476G_DISCOVERY_DAC_H */
 
@@ -1,5 +1,6 @@
 
 #include "SysTimer.h"
+#include "SysClock.h"
 
 uint32_t msTicks;
 
@@ -16,7 +17,7 @@ void SysTick_Init(void){
 	SysTick->CTRL = 0;										// Disable SysTick IRQ and SysTick Counter
 	
 	// SysTick Reload Value Register
-	SysTick->LOAD = 80000000/1000 - 1;    // 1ms, Default clock
+	SysTick->LOAD = System_Clock_Frequency()/1000 - 1;    // 1ms at the current HCLK
 	
 	// SysTick Current Value Register
 	SysTick->VAL = 0;
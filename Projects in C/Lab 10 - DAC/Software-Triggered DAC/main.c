@@ -5,6 +5,7 @@
 #include "SysTimer.h"
 #include "SysClock.h"
 
+volatile uint32_t Configuration_Cycles;  // CPU cycles of DAC_Configuration(), cold or warm boot
 
 int main(void){
 	unsigned int i = 0, output = 0;
@@ -24,24 +25,22 @@ int main(void){
 	// Analog Outputs: PA5 (DAC1_OUT2)
 	//  0 <=> 0V, 4095 <=> 3.0V 
 	DAC_Init();	
+	Configuration_Cycles = DAC_Configuration_Cycles();
+	
+	// Sample and hold: the DAC only drives PA5 while sampling and refreshing.
+	// Hold capacitor on PA5: 100 nF (sample 0.7 ms, hold 7.3 ms, refresh 87.5 us)
+	DAC_SampleHold_Config(DAC_SH_SAMPLE_US(100), DAC_SH_HOLD_US(100), DAC_SH_REFRESH_US(100));
 	
 	while(1){
 		
 		GPIOD->ODR |= GPIO_ODR_ODR_0;   // Set PD 0 as high
 		
-		// Wait until not busy
-		// This bit is systematically set just after Sample & Hold mode enable and is set each time the
-		// software writes the register DAC_SHSR2 , It is cleared by hardware when the write operation
-		// of DAC_SHSR2 is complete. ( It takes about 3 LSI periods of synchronization).
-		//   0: There is no write operation of DAC_SHSR2 ongoing : DAC_SHSR2 can be written
-		//   1: There is a write operation of DAC_SHSR2 ongoing : DAC_SHSR2 cannot be written
-		while ( (DAC->SR & DAC_SR_BWST2) != 0);
-		
-		// DAC channel2 12-bit right aligned data holding register;
-		DAC->DHR12R2 = (i++) % 4095;
+		// BWST2 is set just after Sample & Hold mode enable and each time the software writes
+		// DAC_SHSR2, until the write is synchronized (about 3 LSI periods). It only guards
+		// SHSR2 (see DAC_SampleHold_Set_Sample), so there is no need to wait for it here.
 		
-		// DAC software trigger register (DAC_SWTRGR)
-		DAC->SWTRIGR |= DAC_SWTRIGR_SWTRIG2; 
+		// DAC channel2 12-bit right aligned data holding register, then software trigger
+		DAC_Write((i++) % 4095);
 		
 		delay(5);
 		GPIOD->ODR &= ~GPIO_ODR_ODR_0;  // Set PD 0 as low
@@ -1,7 +1,7 @@
 #include "DAC.h"
 #include "LED.h"
 #include "SysTimer.h"
-#include "SysTimer.h"
+#include "SysClock.h"
 
 #include "stm32l476xx.h"
 #include <stdint.h>
@@ -18,7 +18,7 @@ void DAC_Init(void){
 	DAC_Configuration();
 	
 	//NVIC_EnableIRQ(TIM6_DAC_IRQn);
-	NVIC_EnableIRQ(TIM4_IRQn);
+	// No TIM4 interrupt: samples are moved by DMA, see DAC_DMA_Start()
 
 }
 	
@@ -48,12 +48,28 @@ void DAC_Pin_Configuration(void){
 
 // ******************************************************************************************
 // DAC Configuration
+//  The DWT cycle counter times the whole function: DAC_Configuration_Cycles() and
+//  DAC_Calibration_Restored() tell what a cold (calibrated) or warm (restored) boot cost.
 // ******************************************************************************************
+static uint32_t DAC_Configuration_Time;
+static uint32_t DAC_Configuration_Warm;
+
+static void DAC_Cycle_Counter_Init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 void DAC_Configuration(void){
+	uint32_t start;
+	
+	DAC_Cycle_Counter_Init();
+	start = DWT->CYCCNT;
 	
 	RCC->APB1ENR1 |= RCC_APB1ENR1_DAC1EN;  // Enable DAC Clock
 	
-	DAC_Calibration_Channel(2);  // Calibrate DAC Channel 2
+	DAC_Configuration_Warm = DAC_Calibration_Restore(2);
+	if (DAC_Configuration_Warm == 0)  // Cold boot: no trim stored in the backup domain
+		DAC_Calibration_Channel(2);  // Calibrate DAC Channel 2
 
 	// DAC mode control register (DAC_MCR)
 	// - DAC Channel 2 in normal Mode
@@ -86,6 +102,287 @@ void DAC_Configuration(void){
 	DAC->CR |=  DAC_CR_EN2;       // Enable DAC Channel 2
 	
 	delay(1);
+	
+	DAC_Configuration_Time = DWT->CYCCNT - start;
+}
+
+// CPU cycles of the last DAC_Configuration()
+uint32_t DAC_Configuration_Cycles(void){
+	return DAC_Configuration_Time;
+}
+
+// 1: the last DAC_Configuration() restored the stored OTRIM (warm), 0: it calibrated (cold)
+uint32_t DAC_Calibration_Restored(void){
+	return DAC_Configuration_Warm;
+}
+
+// ******************************************************************************************
+// DAC DMA Streaming
+//  With DMAEN2 set, every TIM4_TRGO moves DHR12R2 to the output and the DAC requests the
+//  next sample: DMA 2 Channel 5 copies it from a circular table into DHR12R2. No interrupt
+//  per sample, so the rate is only limited by the DAC itself (DAC_MAX_RATE, TIM4 at 1 MHz).
+//  table:  length 12-bit right-aligned samples, replayed forever (circular mode).
+//  half, full: optional, called when the first/second half of the table has been sent, to
+//          refill it (double buffering). The table must then be in RAM. With both 0, no
+//          interrupt is enabled at all.
+// ******************************************************************************************
+static DAC_DMA_Callback DAC_DMA_Half_Callback;
+static DAC_DMA_Callback DAC_DMA_Full_Callback;
+static uint16_t *DAC_DMA_Buffer;
+static uint32_t DAC_DMA_Length;
+
+void DAC_DMA_Start(const uint16_t *table, uint32_t length, DAC_DMA_Callback half, DAC_DMA_Callback full){
+	
+	DAC_DMA_Stop();
+	
+	DAC_DMA_Buffer = (uint16_t *) table;
+	DAC_DMA_Length = length;
+	DAC_DMA_Half_Callback = half;
+	DAC_DMA_Full_Callback = full;
+	
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;   // Enable DMA 2 Clock
+	
+	// DMA channel selection register (DMA_CSELR)
+	// 0011: Channel 5 mapped on DAC1_CH2
+	DMA2_CSELR->CSELR &= ~DMA_CSELR_C5S;
+	DMA2_CSELR->CSELR |= 3U << 16;
+	
+	DMA2_Channel5->CPAR  = (uint32_t) &DAC->DHR12R2;  // Peripheral address
+	DMA2_Channel5->CMAR  = (uint32_t) table;          // Memory address
+	DMA2_Channel5->CNDTR = length;                    // Number of transfers per table cycle
+	
+	// DMA channel configuration register (DMA_CCR)
+	//   DIR   = 1: Read from memory
+	//   MSIZE = 01: 16-bit samples, PSIZE = 10: 32-bit register (zero-extended)
+	//   MINC  = 1: Memory increment, CIRC = 1: Circular mode
+	//   PL    = 10: High priority
+	DMA2_Channel5->CCR &= ~(DMA_CCR_PSIZE | DMA_CCR_MSIZE | DMA_CCR_PL | DMA_CCR_MEM2MEM | DMA_CCR_PINC |
+	                        DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE);
+	DMA2_Channel5->CCR |=   DMA_CCR_DIR | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PL_1;
+	
+	DMA2->IFCR = DMA_IFCR_CGIF5;  // Clear all pending flags of channel 5
+	if (half != 0 || full != 0) {
+		DMA2_Channel5->CCR |= DMA_CCR_HTIE | DMA_CCR_TCIE;  // Half transfer, transfer complete
+		NVIC_SetPriority(DMA2_Channel5_IRQn, 0);
+		NVIC_EnableIRQ(DMA2_Channel5_IRQn);
+	} else {
+		NVIC_DisableIRQ(DMA2_Channel5_IRQn);
+	}
+	
+	DMA2_Channel5->CCR |= DMA_CCR_EN;  // Enable DMA channel
+	
+	DAC->CR &= ~(DAC_CR_WAVE2 | DAC_CR_MAMP2);  // No hardware waveform on top of the samples
+	DAC->SR  = DAC_SR_DMAUDR2;         // Clear a stale underrun
+	DAC->CR |= DAC_CR_DMAEN2;          // DAC channel 2 DMA enable
+}
+
+void DAC_DMA_Stop(void){
+	DAC->CR &= ~DAC_CR_DMAEN2;
+	DMA2_Channel5->CCR &= ~DMA_CCR_EN;
+}
+
+// DMA underrun: a trigger came before the previous request was served. The DAC stops
+// requesting, the stream must be restarted (DAC_DMA_Start). Returns 1 once and clears it.
+uint32_t DAC_DMA_Underrun(void){
+	if ((DAC->SR & DAC_SR_DMAUDR2) == 0)
+		return 0;
+	DAC->SR = DAC_SR_DMAUDR2;
+	return 1;
+}
+
+// ******************************************************************************************
+// 	DMA 2 Channel 5 Interrupt Handler (only with refill callbacks)
+// ******************************************************************************************
+void DMA2_Channel5_IRQHandler(void){
+	uint32_t half = DAC_DMA_Length / 2;
+	
+	// Half Transfer: the first half of the table has been sent and may be rewritten
+	if ((DMA2->ISR & DMA_ISR_HTIF5) == DMA_ISR_HTIF5) {
+		DMA2->IFCR = DMA_IFCR_CHTIF5;
+		if (DAC_DMA_Half_Callback != 0)
+			DAC_DMA_Half_Callback(DAC_DMA_Buffer, half);
+	}
+	
+	// Transfer Complete: the second half has been sent
+	if ((DMA2->ISR & DMA_ISR_TCIF5) == DMA_ISR_TCIF5) {
+		DMA2->IFCR = DMA_IFCR_CTCIF5;
+		if (DAC_DMA_Full_Callback != 0)
+			DAC_DMA_Full_Callback(DAC_DMA_Buffer + half, DAC_DMA_Length - half);
+	}
+	
+	// Transfer Error: the channel is disabled by hardware
+	if ((DMA2->ISR & DMA_ISR_TEIF5) == DMA_ISR_TEIF5) {
+		DMA2->IFCR = DMA_IFCR_CGIF5;
+	}
+}
+
+// ******************************************************************************************
+// DAC Hardware Waveforms
+//  The DAC itself adds a triangle or LFSR noise to DHR12R2 on every trigger (TIM4_TRGO):
+//  no CPU and no DMA involved. bits (1..12) sets MAMP2 = bits - 1:
+//    DAC_WAVE_TRIANGLE: counts 0 .. 2^bits - 1 .. 0, one step per trigger, added to base.
+//                       Period = 2 * (2^bits - 1) triggers, e.g. bits = 12 at 1 MHz: 122 Hz.
+//    DAC_WAVE_NOISE:    the low bits of a 12-bit LFSR are added to base: white noise of
+//                       2^bits LSB peak-to-peak.
+//    DAC_WAVE_NONE:     base only (a DC level).
+//  base + 2^bits - 1 must not exceed 4095 (the sum wraps around): base is reduced if needed.
+//  Stops DMA streaming (DAC_DMA_Start), which would overwrite base.
+// ******************************************************************************************
+void DAC_Wave_Config(uint32_t wave, uint32_t bits, uint32_t base){
+	uint32_t peak;
+	
+	DAC_DMA_Stop();
+	
+	if (bits < 1)
+		bits = 1;
+	if (bits > 12)
+		bits = 12;
+	peak = (1U << bits) - 1;
+	if (wave == DAC_WAVE_NONE)
+		peak = 0;
+	if (base + peak > 4095)
+		base = 4095 - peak;
+	
+	DAC->DHR12R2 = base;
+	
+	// WAVE2: 00 = disabled, 01 = noise, 1x = triangle (only used when TEN2 = 1)
+	// MAMP2: mask (noise) or amplitude (triangle), 2^(MAMP2 + 1) - 1
+	DAC->CR &= ~(DAC_CR_WAVE2 | DAC_CR_MAMP2);
+	if (wave == DAC_WAVE_NOISE)
+		DAC->CR |= DAC_CR_WAVE2_0 | ((bits - 1) << 24);
+	else if (wave == DAC_WAVE_TRIANGLE)
+		DAC->CR |= DAC_CR_WAVE2_1 | ((bits - 1) << 24);
+}
+
+// ******************************************************************************************
+// DAC Offset Trim Storage
+//  The result of DAC_Calibration_Channel() (OTRIM, 5 bits) is kept in the RTC backup
+//  registers, which survive a reset (warm boot) as long as VDD or VBAT is present. At init,
+//  DAC_Calibration_Restore() loads it instead of running the binary search: 4 steps and a
+//  final check, each after a delay(1). delay(1) lasts until the next SysTick tick, so the
+//  first one takes 0 to 1 ms and the others about 1 ms: 4 to 5 ms per channel, against
+//  about 0.14 ms for the temperature reading (120 us start-up and two 8 us conversions).
+//  The offset drifts with temperature, so one value is kept per channel and per band of
+//  DAC_TRIM_BAND_WIDTH degC, from the internal temperature sensor (ADC1_IN17):
+//    BKPxR, x = DAC_TRIM_BKP + (channel - 1) * DAC_TRIM_BANDS + band
+//    bits 31:16 = DAC_TRIM_MAGIC, bits 4:0 = OTRIM
+//  A cold boot (backup domain reset) clears them: the full calibration runs and stores its
+//  result in the band read by DAC_Calibration_Restore(): the temperature is read once per
+//  boot. To force it, call DAC_Calibration_Channel() directly (it reads the band again).
+//  Needs write access to the backup domain (DBP), set in LCD_Clock_Init().
+// ******************************************************************************************
+
+// Busy wait on the DWT cycle counter, at the current HCLK
+static void DAC_Wait_us(uint32_t us){
+	uint32_t start, cycles;
+	
+	DAC_Cycle_Counter_Init();
+	cycles = us * (System_Clock_Frequency() / 1000000U);
+	start = DWT->CYCCNT;
+	while ((DWT->CYCCNT - start) < cycles);
+}
+
+// ******************************************************************************************
+// One coarse temperature reading (degC) with ADC1, which is left disabled afterwards.
+// VDDA is taken as 3.0 V (the calibration voltage): good enough to select a band.
+// ******************************************************************************************
+static int32_t DAC_Temperature(void){
+	uint32_t data, n;
+	int32_t cal1, cal2;
+	
+	RCC->AHB2ENR |= RCC_AHB2ENR_ADCEN;         // Enable ADC Clock
+	
+	// CKMODE = 01: HCLK/1 (synchronous clock), TSEN: temperature sensor enable
+	// Both are writable only while all ADCs are disabled
+	ADC123_COMMON->CCR &= ~ADC_CCR_CKMODE;
+	ADC123_COMMON->CCR |=  ADC_CCR_CKMODE_0 | ADC_CCR_TSEN;
+	
+	ADC1->CR &= ~ADC_CR_DEEPPWD;               // Exit deep power down
+	ADC1->CR |=  ADC_CR_ADVREGEN;              // Enable the voltage regulator
+	DAC_Wait_us(120);                          // Regulator (20 us) and sensor (120 us) start-up
+	
+	ADC1->ISR = ADC_ISR_ADRDY;
+	ADC1->CR |= ADC_CR_ADEN;
+	while ((ADC1->ISR & ADC_ISR_ADRDY) == 0);
+	
+	ADC1->SQR1 = 17U << 6;                     // L = 0 (1 conversion), SQ1 = 17 (VTS)
+	ADC1->SMPR2 |= ADC_SMPR2_SMP17;            // 111: 640.5 cycles = 8 us, VTS needs 5 us
+	
+	// Two conversions: the first one after the ADC has been idle is not accurate (errata)
+	data = 0;
+	for (n = 0; n < 2; n++) {
+		ADC1->CR |= ADC_CR_ADSTART;
+		while ((ADC1->ISR & ADC_ISR_EOC) == 0);
+		data = ADC1->DR;
+	}
+	
+	ADC1->CR |= ADC_CR_ADDIS;
+	while ((ADC1->CR & ADC_CR_ADEN) != 0);
+	ADC1->CR &= ~ADC_CR_ADVREGEN;
+	ADC1->CR |=  ADC_CR_DEEPPWD;
+	ADC123_COMMON->CCR &= ~ADC_CCR_TSEN;
+	
+	cal1 = *TS_CAL1_ADDR;
+	cal2 = *TS_CAL2_ADDR;
+	if (cal2 == cal1)
+		return TS_CAL1_TEMP;
+	return (TS_CAL2_TEMP - TS_CAL1_TEMP) * ((int32_t) data - cal1) / (cal2 - cal1) + TS_CAL1_TEMP;
+}
+
+static uint32_t DAC_Trim_Band;          // Temperature band of the last reading
+static uint32_t DAC_Trim_Band_Pending;  // 1: read by a restore that found nothing, for the save
+
+static void DAC_Trim_Band_Read(void){
+	int32_t band;
+	
+	band = (DAC_Temperature() - DAC_TRIM_BAND_MIN) / DAC_TRIM_BAND_WIDTH;
+	if (band < 0)
+		band = 0;
+	if (band > DAC_TRIM_BANDS - 1)
+		band = DAC_TRIM_BANDS - 1;
+	DAC_Trim_Band = (uint32_t) band;
+}
+
+// Backup register of the channel in the band of the last reading
+static volatile uint32_t *DAC_Trim_Register(uint32_t channel){
+	return &RTC->BKP0R + DAC_TRIM_BKP + (channel - 1) * DAC_TRIM_BANDS + DAC_Trim_Band;
+}
+
+// ******************************************************************************************
+// Load the stored OTRIM of the channel. Returns 1 if found, 0 if it must be calibrated.
+// ******************************************************************************************
+uint32_t DAC_Calibration_Restore(uint32_t channel){
+	uint32_t record, trim;
+	
+	DAC_Trim_Band_Read();
+	record = *DAC_Trim_Register(channel);
+	if ((record >> 16) != DAC_TRIM_MAGIC) {
+		DAC_Trim_Band_Pending = 1;            // The calibration that follows saves in this band
+		return 0;
+	}
+	
+	DAC_Trim_Band_Pending = 0;
+	trim = record & 0x1F;
+	if (channel == 1) {
+		DAC->CCR &= ~DAC_CCR_OTRIM1;
+		DAC->CCR |= trim;
+	} else {
+		DAC->CCR &= ~DAC_CCR_OTRIM2;
+		DAC->CCR |= trim << 16;
+	}
+	return 1;
+}
+
+// Store OTRIM of the channel for the current temperature band
+static void DAC_Calibration_Save(uint32_t channel, uint32_t trim){
+	
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;       // Power interface clock enable
+	PWR->CR1 |= PWR_CR1_DBP;                   // Enable write access to Backup domain
+	
+	if (DAC_Trim_Band_Pending == 0)
+		DAC_Trim_Band_Read();
+	DAC_Trim_Band_Pending = 0;
+	*DAC_Trim_Register(channel) = (DAC_TRIM_MAGIC << 16) | (trim & 0x1F);
 }
 
 // ******************************************************************************************
@@ -160,4 +457,6 @@ void DAC_Calibration_Channel(uint32_t channel){
 	}
 	
 	DAC->CR &= ~DAC_CR_CEN_Flag; 
+	
+	DAC_Calibration_Save(channel, trimmingvalue);
 }
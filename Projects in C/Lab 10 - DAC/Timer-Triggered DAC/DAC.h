@@ -3,12 +3,41 @@
 
 #include "stm32l476xx.h"
 
+// Stored offset trim (see DAC_Calibration_Restore)
+#define  DAC_TRIM_BKP          8U        // First RTC backup register used (BKP8R)
+#define  DAC_TRIM_BANDS        8         // Temperature bands per channel (BKP8R..BKP23R)
+#define  DAC_TRIM_BAND_MIN     (-40)     // degC, lower edge of band 0
+#define  DAC_TRIM_BAND_WIDTH   20        // degC
+#define  DAC_TRIM_MAGIC        0xDAC0U   // Marks a valid record (bits 31:16)
+
+// Temperature sensor factory calibration, raw data acquired at VDDA = 3.0 V
+#define  TS_CAL1_ADDR          ((uint16_t *) 0x1FFF75A8U)
+#define  TS_CAL2_ADDR          ((uint16_t *) 0x1FFF75CAU)
+#define  TS_CAL1_TEMP          30        // degC
+#define  TS_CAL2_TEMP          110       // degC
+
 #define  DAC_SAMPLE_SIZE   ADC_SAMPLE_SIZE
+#define  DAC_MAX_RATE      1000000U    // Samples per second, buffered output (datasheet)
+
+// Hardware waveform generation (WAVE2), see DAC_Wave_Config()
+#define  DAC_WAVE_NONE     0U
+#define  DAC_WAVE_NOISE    1U          // LFSR noise
+#define  DAC_WAVE_TRIANGLE 2U
+
+// Called from the DMA interrupt with the half of the circular buffer that was just sent
+typedef void (*DAC_DMA_Callback)(uint16_t *samples, uint32_t length);
 
 void DAC_Init(void);
 void DAC_Pin_Configuration(void);
 void DAC_Configuration(void);
 void DAC_Calibration_Channel(uint32_t channel);
+uint32_t DAC_Calibration_Restore(uint32_t channel);
+uint32_t DAC_Calibration_Restored(void);
+uint32_t DAC_Configuration_Cycles(void);
+void DAC_DMA_Start(const uint16_t *table, uint32_t length, DAC_DMA_Callback half, DAC_DMA_Callback full);
+void DAC_DMA_Stop(void);
+uint32_t DAC_DMA_Underrun(void);
+void DAC_Wave_Config(uint32_t wave, uint32_t bits, uint32_t base);
 
 #endif /* __STM32L476G_DISCOVERY_DAC_H */
 
@@ -0,0 +1,125 @@
+#include "DDS.h"
+#include <stdint.h>
+
+// ******************************************************************************************
+// Direct Digital Synthesis
+//  A 32-bit phase accumulator advances by the tuning word on every sample:
+//    step = frequency * 2^32 / sample_rate   (resolution: sample_rate / 2^32)
+//  The top DDS_TABLE_BITS of the phase index a Q15 table, the next 15 bits interpolate
+//  linearly to the following entry (the guard entry makes the wrap free). The result is
+//  scaled by the Q15 amplitude and offset to the 12-bit DAC range around DDS_MIDSCALE.
+//
+//  DDS_Fill() computes one block, e.g. the half of the DAC DMA buffer that was just sent.
+//  Frequency, amplitude and table are only taken at the start of a block: the phase never
+//  jumps, and the amplitude moves linearly from its old to its new value over the block.
+//  The DDS_Set_xxx functions may be called at any time from the main loop.
+//
+//  Tables are const (flash) and computed by the compiler from the DDS_TABLE() repetition
+//  macro: the sine from a Taylor series on the quarter wave (no math library, exact to the
+//  rounding), triangle and square from integer expressions. Any other periodic waveform
+//  can be used as well: same format, DDS_TABLE_SIZE + 1 Q15 entries.
+//  Full-scale sine (Tests/test_dds.c): the spurs are at -48 dBc without interpolation (8-bit
+//  phase), at -83 dBc or lower with it, where the 12-bit quantization of the DAC dominates.
+// ******************************************************************************************
+// Entry k folded to the first quarter wave (0 .. 64), and the sign of its half period
+#define  DDS_QUARTER(k)       (((k) & 127) <= 64 ? ((k) & 127) : 128 - ((k) & 127))
+#define  DDS_SIGN(k)          (((k) & 255) < 128 ? 1 : -1)
+
+// sin(x) for 0 <= x <= pi / 2: Taylor series up to x^13, error below 1e-9
+#define  DDS_SIN(x)           ((x) * (1 - (x) * (x) / 6 * (1 - (x) * (x) / 20 * (1 - (x) * (x) / 42 * \
+                              (1 - (x) * (x) / 72 * (1 - (x) * (x) / 110 * (1 - (x) * (x) / 156)))))))
+
+// round(32767 sin(2 pi k / 256))
+#define  DDS_SINE(k)          (int16_t) (DDS_SIGN(k) * (int32_t) (32767 * DDS_SIN(DDS_QUARTER(k) * 0.0245436926061703) + 0.5)),
+
+// Triangle, 0 at k = 0, peak at k = 64: 32767 k / 64 rounded down at .5
+#define  DDS_TRIANGLE(k)      (int16_t) (DDS_SIGN(k) * (int32_t) ((32767L * DDS_QUARTER(k) + 32) / 64)),
+
+// Square, 50% duty
+#define  DDS_SQUARE(k)        (int16_t) (DDS_SIGN(k) * 32767),
+
+const int16_t DDS_Sine[DDS_TABLE_SIZE + 1]     = { DDS_TABLE(DDS_SINE) };
+const int16_t DDS_Triangle[DDS_TABLE_SIZE + 1] = { DDS_TABLE(DDS_TRIANGLE) };
+const int16_t DDS_Square[DDS_TABLE_SIZE + 1]   = { DDS_TABLE(DDS_SQUARE) };
+
+void DDS_Init(DDS *dds, const int16_t *table, uint32_t sample_rate, uint32_t interpolate){
+	dds->phase = 0;
+	dds->step = 0;
+	dds->amplitude = 0;
+	dds->sample_rate = sample_rate;
+	dds->interpolate = interpolate;
+	dds->next_step = 0;
+	dds->next_amplitude = 0;
+	dds->table = table;
+}
+
+// frequency in Hz, below sample_rate / 2
+void DDS_Set_Frequency(DDS *dds, uint32_t frequency){
+	dds->next_step = (uint32_t) (((uint64_t) frequency << 32) / dds->sample_rate);
+}
+
+// Tuning word, for a resolution finer than 1 Hz
+void DDS_Set_Step(DDS *dds, uint32_t step){
+	dds->next_step = step;
+}
+
+// Q15, 0 (silence) .. DDS_FULL_SCALE (0..4095)
+void DDS_Set_Amplitude(DDS *dds, int32_t amplitude){
+	if (amplitude < 0)
+		amplitude = 0;
+	if (amplitude > DDS_FULL_SCALE)
+		amplitude = DDS_FULL_SCALE;
+	dds->next_amplitude = amplitude;
+}
+
+void DDS_Set_Table(DDS *dds, const int16_t *table){
+	dds->table = table;
+}
+
+// ******************************************************************************************
+// One block of 12-bit DAC samples
+// ******************************************************************************************
+void DDS_Fill(DDS *dds, uint16_t *samples, uint32_t length){
+	const int16_t *table;
+	uint32_t i, phase, step, index, fraction;
+	int32_t value, gain, slope, target;
+	
+	if (length == 0)
+		return;
+	
+	// Block boundary: take the new parameters
+	table  = dds->table;
+	step   = dds->next_step;
+	target = dds->next_amplitude;
+	phase  = dds->phase;
+	
+	// Amplitude in Q15.16 so that the ramp over the block has no steps of more than 1 LSB
+	// (* 65536, not << 16: the difference may be negative)
+	gain  = dds->amplitude * 65536;
+	slope = (target - dds->amplitude) * 65536 / (int32_t) length;
+	
+	if (dds->interpolate) {
+		for (i = 0; i < length; i++) {
+			index = phase >> (32 - DDS_TABLE_BITS);
+			fraction = (phase >> (32 - DDS_TABLE_BITS - 15)) & 0x7FFF;
+			value = table[index];
+			value += ((table[index + 1] - value) * (int32_t) fraction) >> 15;
+			value = (value * (gain >> 16)) >> 15;
+			samples[i] = (uint16_t) (DDS_MIDSCALE + (value >> 4));
+			gain += slope;
+			phase += step;
+		}
+	} else {
+		for (i = 0; i < length; i++) {
+			value = table[phase >> (32 - DDS_TABLE_BITS)];
+			value = (value * (gain >> 16)) >> 15;
+			samples[i] = (uint16_t) (DDS_MIDSCALE + (value >> 4));
+			gain += slope;
+			phase += step;
+		}
+	}
+	
+	dds->phase = phase;
+	dds->step = step;
+	dds->amplitude = target;
+}
@@ -0,0 +1,45 @@
+#ifndef __STM32L476G_DISCOVERY_DDS_H
+#define __STM32L476G_DISCOVERY_DDS_H
+
+// Plain C, no device header: DDS.c also builds on the host (Tests/)
+#include <stdint.h>
+
+#define  DDS_TABLE_BITS     8
+#define  DDS_TABLE_SIZE     (1U << DDS_TABLE_BITS)   // Entries per period, plus one guard entry
+#define  DDS_MIDSCALE       2048                     // DAC code of a zero sample
+#define  DDS_FULL_SCALE     32767                    // Amplitude of a full-scale (0..4095) output
+
+// Phase-accumulator synthesizer, one per output
+typedef struct {
+	uint32_t phase;                       // Phase accumulator, 2^32 = one period
+	uint32_t step;                        // Tuning word in use: phase increment per sample
+	int32_t  amplitude;                   // Q15 amplitude in use
+	uint32_t sample_rate;                 // Hz, DAC trigger rate
+	uint32_t interpolate;                 // 1: linear interpolation between table entries
+	volatile uint32_t next_step;          // Taken at the start of the next block
+	volatile int32_t  next_amplitude;
+	const int16_t * volatile table;
+} DDS;
+
+// Compile-time tables: DDS_TABLE(ENTRY) expands ENTRY(k) for k = 0 .. DDS_TABLE_SIZE (the
+// guard entry), for DDS_TABLE_BITS = 8. ENTRY(k) is a constant expression and a comma, e.g.
+//   #define  SAWTOOTH(k)   (int16_t) ((((k) & 255) - 128) * 256),
+//   const int16_t Sawtooth[DDS_TABLE_SIZE + 1] = { DDS_TABLE(SAWTOOTH) };
+#define  DDS_REPEAT4(M, k)    M(k) M((k) + 1) M((k) + 2) M((k) + 3)
+#define  DDS_REPEAT16(M, k)   DDS_REPEAT4(M, k) DDS_REPEAT4(M, (k) + 4) DDS_REPEAT4(M, (k) + 8) DDS_REPEAT4(M, (k) + 12)
+#define  DDS_REPEAT64(M, k)   DDS_REPEAT16(M, k) DDS_REPEAT16(M, (k) + 16) DDS_REPEAT16(M, (k) + 32) DDS_REPEAT16(M, (k) + 48)
+#define  DDS_TABLE(M)         DDS_REPEAT64(M, 0) DDS_REPEAT64(M, 64) DDS_REPEAT64(M, 128) DDS_REPEAT64(M, 192) M(256)
+
+// Q15 waveform tables, DDS_TABLE_SIZE + 1 entries (the last one equals the first)
+extern const int16_t DDS_Sine[DDS_TABLE_SIZE + 1];
+extern const int16_t DDS_Triangle[DDS_TABLE_SIZE + 1];
+extern const int16_t DDS_Square[DDS_TABLE_SIZE + 1];
+
+void DDS_Init(DDS *dds, const int16_t *table, uint32_t sample_rate, uint32_t interpolate);
+void DDS_Set_Frequency(DDS *dds, uint32_t frequency);
+void DDS_Set_Step(DDS *dds, uint32_t step);
+void DDS_Set_Amplitude(DDS *dds, int32_t amplitude);
+void DDS_Set_Table(DDS *dds, const int16_t *table);
+void DDS_Fill(DDS *dds, uint16_t *samples, uint32_t length);
+
+#endif /* __STM32L476G_DISCOVERY_DDS_H */
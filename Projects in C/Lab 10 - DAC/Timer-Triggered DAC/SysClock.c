@@ -101,3 +101,86 @@ void System_Clock_Init(void){
 
 	RCC->APB2ENR |= RCC_APB2ENR_SAI1EN;
 }
+
+// ******************************************************************************************
+// Current core clock (HCLK) in Hz, decoded from the RCC registers.
+// SYSCLK is taken from the source reported by SWS (MSI, HSI16, HSE or PLLCLK) and divided by
+// the AHB prescaler. The core, SysTick and the DWT cycle counter all run at this frequency.
+// ******************************************************************************************
+static const uint32_t MSI_Range_Table[12] = {
+	100000U,   200000U,   400000U,   800000U,   1000000U,  2000000U,   // range 0 - 5
+	4000000U,  8000000U,  16000000U, 24000000U, 32000000U, 48000000U   // range 6 - 11
+};
+
+static uint32_t MSI_Frequency(void){
+	uint32_t range;
+	
+	// MSIRGSEL = 1: range given by MSIRANGE in RCC_CR
+	// MSIRGSEL = 0: range given by MSISRANGE in RCC_CSR (after standby)
+	if ((RCC->CR & RCC_CR_MSIRGSEL) == RCC_CR_MSIRGSEL)
+		range = (RCC->CR & RCC_CR_MSIRANGE) >> 4;
+	else
+		range = (RCC->CSR & RCC_CSR_MSISRANGE) >> 8;
+	
+	if (range > 11)
+		range = 11;
+	return MSI_Range_Table[range];
+}
+
+uint32_t System_Clock_Frequency(void){
+	uint32_t sysclk, input, pllm, plln, pllr, hpre;
+	
+	switch (RCC->CFGR & RCC_CFGR_SWS) {
+		case RCC_CFGR_SWS_HSI:   // 01: HSI16
+			sysclk = 16000000U;
+			break;
+		case RCC_CFGR_SWS_HSE:   // 10: HSE
+			sysclk = HSE_FREQUENCY;
+			break;
+		case RCC_CFGR_SWS_PLL:   // 11: PLL
+			// 00 = No clock, 01 = MSI, 10 = HSI, 11 = HSE
+			switch (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) {
+				case RCC_PLLCFGR_PLLSRC_MSI: input = MSI_Frequency(); break;
+				case RCC_PLLCFGR_PLLSRC_HSI: input = 16000000U;       break;
+				case RCC_PLLCFGR_PLLSRC_HSE: input = HSE_FREQUENCY;   break;
+				default:                     input = 0;               break;
+			}
+			// f(PLL_R) = f(PLL clock input) * PLLN / PLLM / PLLR
+			pllm = ((RCC->PLLCFGR & RCC_PLLCFGR_PLLM) >> 4) + 1;        // 000: PLLM = 1, ...
+			plln =  (RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> 8;
+			pllr = (((RCC->PLLCFGR & RCC_PLLCFGR_PLLR) >> 25) + 1) * 2; // 00: PLLR = 2, ...
+			sysclk = input / pllm * plln / pllr;
+			break;
+		default:                 // 00: MSI
+			sysclk = MSI_Frequency();
+			break;
+	}
+	
+	// AHB prescaler: 0xxx = not divided, 1000 = /2, ..., 1011 = /16, 1100 = /64, ..., 1111 = /512
+	hpre = (RCC->CFGR & RCC_CFGR_HPRE) >> 4;
+	if (hpre >= 8) {
+		hpre -= 7;         // 1 - 8
+		if (hpre >= 5)
+			hpre++;          // /32 is skipped
+		sysclk >>= hpre;
+	}
+	
+	return sysclk;
+}
+
+// ******************************************************************************************
+// Clock of the timers on APB1 (TIM2 - TIM7) in Hz.
+// PCLK1 = HCLK / APB1 prescaler. The timers run at PCLK1 when the prescaler is 1 and at
+// 2 x PCLK1 otherwise.
+// ******************************************************************************************
+uint32_t System_APB1_Timer_Frequency(void){
+	uint32_t hclk, ppre1;
+	
+	hclk = System_Clock_Frequency();
+	
+	// APB1 prescaler: 0xx = not divided, 100 = /2, 101 = /4, 110 = /8, 111 = /16
+	ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> 8;
+	if (ppre1 < 4)
+		return hclk;
+	return (hclk >> (ppre1 - 3)) * 2;
+}
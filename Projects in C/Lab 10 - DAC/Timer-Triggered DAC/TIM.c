@@ -1,15 +1,18 @@
 #include "TIM.h"
 #include "LED.h"
+#include "SysClock.h"
 #include "stm32l476xx.h"
 #include <stdint.h>
 
 // ******************************************************************************************
 // GPIO PB6 as TIM4_CH1 for ADC and DAC triggers		
+// TIM4_TRGO (OC1REF) moves one sample into the DAC per timer period, frequency in Hz.
 // ******************************************************************************************
-void TIM4_Init(void){
+void TIM4_Init(uint32_t frequency){
 	
 	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM4EN; // Enable Clock of Timer 4
 	
+	TIM4->CR1  &= ~TIM_CR1_CEN;  // Disable counter while configuring
 	TIM4->CR1  &= ~TIM_CR1_CMS;  // Edge-aligned mode
 	TIM4->CR1  &= ~TIM_CR1_DIR;  // Counting direction: Up Counting
  	
@@ -25,9 +28,8 @@ void TIM4_Init(void){
 	TIM4->CR2  &= ~TIM_CR2_MMS;  // Master mode selection  //page 1059
 	TIM4->CR2  |= TIM_CR2_MMS_2; // 100 = OC1REF as TRGO 
 
-	TIM4->DIER |= TIM_DIER_TIE;  // Trigger interrupt enable //page 1063
-	
-	TIM4->DIER |= TIM_DIER_UIE;  // Update interrupt enable //page 1064
+	// No timer interrupts: the DAC is fed by DMA on every TRGO without any CPU involvement
+	TIM4->DIER &= ~(TIM_DIER_TIE | TIM_DIER_UIE);  //page 1063
 	
 	// OC1M: Output Compare 1 mode
 	// 0110: PWM mode 1 - In upcounting, channel 1 is active as long as TIMx_CNT < TIMx_CCR1
@@ -36,14 +38,7 @@ void TIM4_Init(void){
 	TIM4->CCMR1 &= ~TIM_CCMR1_OC1M; //page 1066
 	TIM4->CCMR1 |= TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_2;  // 0110 = PWM mode 1  //page 1068
 	
-	// The counter clock frequency (CK_CNT) = fCK_PSC / (PSC[15:0] + 1)
-	// Timer driving frequency = 80 MHz/(1 + PSC) = 80 MHz/(1+7) = 10MHz
-	TIM4->PSC  =   7;    // max 65535
-	
-  // Trigger frequency = 10MHz / (1 + ARR) = 10MHz/1000 = 10KHz
-	TIM4->ARR  = 999;   // max 65535
-	
-	TIM4->CCR1 = 500;   // Duty ration 50%
+	TIM4_Set_Frequency(frequency);
 	 
 	TIM4->CCER |= TIM_CCER_CC1E;  //  OC1 signal is output on the corresponding output pin
 	
@@ -58,3 +53,25 @@ void TIM4_Init(void){
 	GPIOB->AFR[0] |=  0x02000000;    // AF2 = TIM4_CH1N for PB6	
 }
 
+// ******************************************************************************************
+// Set the TIM4 trigger frequency in Hz
+// The counter clock frequency (CK_CNT) = fCK_PSC / (PSC[15:0] + 1)
+// Trigger frequency = APB1 timer clock / (1 + PSC) / (1 + ARR)
+// e.g. 10 kHz: PSC = 0, ARR = 7999; 1 MHz: PSC = 0, ARR = 79
+// ******************************************************************************************
+void TIM4_Set_Frequency(uint32_t frequency){
+	uint32_t ticks, prescaler;
+	
+	if (frequency == 0)
+		frequency = 1;
+	
+	ticks = System_APB1_Timer_Frequency() / frequency;    // Timer clock cycles per trigger
+	if (ticks < 2)
+		ticks = 2;
+	prescaler = ticks / 65536U;            // Smallest prescaler that keeps ARR within 16 bits
+	
+	TIM4->PSC  = prescaler;                              // max 65535
+	TIM4->ARR  = ticks / (prescaler + 1) - 1;            // max 65535
+	TIM4->CCR1 = (TIM4->ARR + 1) / 2;                    // Duty ratio 50%
+	TIM4->EGR  = TIM_EGR_UG;                             // Load PSC now instead of at the next update
+}
@@ -3,6 +3,7 @@
 
 #include "stm32l476xx.h"
 
-void TIM4_Init(void);
+void TIM4_Init(uint32_t frequency);
+void TIM4_Set_Frequency(uint32_t frequency);
 
 #endif /* __STM32L476G_DISCOVERY_TIM_H */
@@ -5,12 +5,31 @@
 #include "LED.h"
 #include "SysTimer.h"
 #include "SysClock.h"
+#include "DDS.h"
 
-volatile uint32_t i;
+#define DAC_RATE    100000  // Samples per second, up to DAC_MAX_RATE
+#define DAC_BLOCK   256     // Samples per DMA half-buffer, 2.56 ms at 100 kHz
+
+uint16_t DAC_Buffer[2 * DAC_BLOCK]; // Played by DMA 2 Channel 5 into DHR12R2, refilled half by half
+DDS Tone;                           // 1 kHz sine, change it with DDS_Set_xxx at any time
+volatile uint32_t Fill_Cycles;      // CPU cycles per sample of the last DDS_Fill()
+volatile uint32_t Configuration_Cycles;  // CPU cycles of DAC_Configuration(), cold or warm boot
+
+// Runs in the DMA interrupt when one half of DAC_Buffer has been sent
+void DAC_Block_Done(uint16_t *samples, uint32_t length){
+	uint32_t start;
+	
+	start = DWT->CYCCNT;
+	DDS_Fill(&Tone, samples, length);
+	Fill_Cycles = (DWT->CYCCNT - start) / length;
+}
 
 int main(void){
 	
-	i = 0;
+	// DWT cycle counter for Fill_Cycles
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 	
 	System_Clock_Init(); // Switch System Clock = 80 MHz
 	SysTick_Init();
@@ -26,11 +45,19 @@ int main(void){
 	
 	//TIM4_TRGO triggers DAC.
 	// GPIO PB6 (TIM4_CH1) is outputed for debugging
-	TIM4_Init();
+	TIM4_Init(DAC_RATE);
 	
 	
 	// Analog Outputs: PA5 (DAC1_OUT2)
 	DAC_Init();
+	Configuration_Cycles = DAC_Configuration_Cycles();
+	
+	// DMA feeds DHR12R2 on every TRGO; one interrupt per DAC_BLOCK samples refills a half
+	DDS_Init(&Tone, DDS_Sine, DAC_RATE, 1);
+	DDS_Set_Frequency(&Tone, 1000);
+	DDS_Set_Amplitude(&Tone, DDS_FULL_SCALE);
+	DDS_Fill(&Tone, DAC_Buffer, 2 * DAC_BLOCK);
+	DAC_DMA_Start(DAC_Buffer, 2 * DAC_BLOCK, DAC_Block_Done, DAC_Block_Done);
 	
 	while(1){
 		//while(Microphone_DMA_Done == 0);
@@ -41,13 +68,6 @@ int main(void){
 	}
 }
 
-void TIM4_IRQHandler(void){	
-	// Clear interrupt flags
-	TIM4->SR = 0;
-	DAC->DHR12R2 = (i++) % 4096;
-}
-
-
 void TIM6_DAC_IRQHandler(void){
 	// Clear interrupt flags
 }